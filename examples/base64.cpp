@@ -17,6 +17,8 @@
 // along with this library; if not, write to the Free Software Foundation,
 // Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 
+#include "../include/jsonrpc-lean/client.h"
+#include "../include/jsonrpc-lean/jsonformathandler.h"
 #include "../include/jsonrpc-lean/util.h"
 
 #include <cassert>
@@ -24,10 +26,73 @@
 #include <fcntl.h>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+namespace {
+
+// The id and the fault message of a response, or of each response in a
+// batch, as one string
+std::string DescribeResponses(jsonrpc::Reader& reader)
+{
+  std::string description;
+  for (auto& response : reader.GetBatchResponse()) {
+    auto& id = response.GetId();
+    assert(id.IsString());
+    description += id.AsString();
+    try {
+      response.ThrowIfFault();
+    }
+    catch (const jsonrpc::Fault& fault) {
+      description += ':';
+      description += fault.GetString();
+    }
+    description += ';';
+  }
+  return description;
+}
+
+// Ids and fault messages are text whatever the binary detection, even when
+// they happen to be valid base64, and the DOM and SAX readers agree on them
+void VerifyReaders()
+{
+  const char* responses[] = {
+    R"({"jsonrpc":"2.0","id":"req1","result":"abcd"})",
+    R"({"jsonrpc":"2.0","id":"req1","error":{"code":-32000,"message":"Fail"}})",
+    R"([{"jsonrpc":"2.0","id":"req1","result":"abcd"},)"
+      R"({"jsonrpc":"2.0","id":"req2","error":{"code":-32000,"message":"Fail","data":{"why":"AAAA"}}}])",
+  };
+  const char* expected[] = {
+    "req1;",
+    "req1:Fail;",
+    "req1;req2:Fail;",
+  };
+  const jsonrpc::BinaryDetection detections[] = {
+    jsonrpc::BinaryDetection::NONE,
+    jsonrpc::BinaryDetection::NUL_BYTE,
+    jsonrpc::BinaryDetection::BASE64,
+  };
+
+  for (auto detection : detections) {
+    for (size_t i = 0; i < sizeof(responses) / sizeof(responses[0]); ++i) {
+      jsonrpc::JsonFormatHandler handler;
+      handler.SetBinaryDetection(detection);
+      const auto dom = DescribeResponses(*handler.CreateReader(responses[i]));
+      handler.SetSaxParsing();
+      const auto sax = DescribeResponses(*handler.CreateReader(responses[i]));
+      assert(dom == expected[i]);
+      assert(sax == expected[i]);
+      (void)dom;
+      (void)sax;
+    }
+  }
+  (void)expected;
+}
+
+} // namespace
+
 int main(int argc, char** argv)
 {
   if (argc != 3) {
@@ -52,6 +117,10 @@ int main(int argc, char** argv)
     return 1;
   }
 
+  if (verify) {
+    VerifyReaders();
+  }
+
   const size_t size = encode ? 28671 : 30030;
   std::unique_ptr<char[]> buffer(new char[size]);
 
@@ -66,6 +135,28 @@ int main(int argc, char** argv)
         auto binary = jsonrpc::util::Base64Decode(str);
         assert(binary.size() == static_cast<size_t>(res));
         assert(memcmp(buffer.get(), binary.data(), res) == 0);
+
+        // And through JSON as a BINARY parameter, decoded by the reader
+        // or afterwards
+        jsonrpc::JsonFormatHandler handler;
+        handler.SetBinaryDetection(jsonrpc::BinaryDetection::BASE64);
+        jsonrpc::Client client(handler);
+        jsonrpc::Value value(std::string(buffer.get(), res), true);
+        auto request = client.BuildRequestData("echo", value);
+        const std::string json(request->GetData(), request->GetSize());
+
+        const auto decodedRequest = handler.CreateReader(json)->GetRequest();
+        auto& params = decodedRequest.GetParameters();
+        assert(params.size() == 1 && params[0].IsBinary());
+        assert(params[0].AsBinary() == value.AsBinary());
+
+        handler.SetBinaryDetection(jsonrpc::BinaryDetection::NUL_BYTE);
+        const auto textRequest = handler.CreateReader(json)->GetRequest();
+        auto& text = textRequest.GetParameters()[0];
+        assert(text.IsString());
+        std::unique_ptr<char[]> decoded(new char[text.GetBinaryMaxSize()]);
+        assert(text.DecodeBinaryTo(decoded.get()) == static_cast<size_t>(res));
+        assert(memcmp(buffer.get(), decoded.get(), res) == 0);
       }
     }
     else {
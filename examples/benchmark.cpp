@@ -0,0 +1,358 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include "../include/jsonrpc-lean/cborformathandler.h"
+#include "../include/jsonrpc-lean/client.h"
+#include "../include/jsonrpc-lean/jsonformathandler.h"
+#include "../include/jsonrpc-lean/jsonreader.h"
+#include "../include/jsonrpc-lean/jsonsaxreader.h"
+#include "../include/jsonrpc-lean/jsonwriter.h"
+#include "../include/jsonrpc-lean/msgpackformathandler.h"
+#include "../include/jsonrpc-lean/request.h"
+#include "../include/jsonrpc-lean/response.h"
+#include "../include/jsonrpc-lean/server.h"
+#include "../include/jsonrpc-lean/simdjsonreader.h"
+#include "../include/jsonrpc-lean/transport.h"
+#include "../include/jsonrpc-lean/util.h"
+
+#include <rapidjson/stringbuffer.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    // Runs fn repeatedly for roughly half a second and reports the
+    // throughput over bytes processed per run
+    void Measure(const std::string& name, size_t bytes, const std::function<void()>& fn) {
+        typedef std::chrono::steady_clock Clock;
+
+        fn(); // warm up
+
+        size_t iterations = 0;
+        const auto start = Clock::now();
+        auto elapsed = Clock::duration::zero();
+        do {
+            fn();
+            ++iterations;
+            elapsed = Clock::now() - start;
+        } while (elapsed < std::chrono::milliseconds(500));
+
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        std::cout << std::left << std::setw(40) << name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(2) << (seconds * 1e6 / iterations) << " us/op"
+            << std::setw(12) << (bytes * iterations / seconds / (1024 * 1024)) << " MB/s\n";
+    }
+
+    // A "store" request whose params hold records until it is at least
+    // size bytes long
+    std::string BuildRequest(size_t size) {
+        std::string request = "{\"jsonrpc\":\"2.0\",\"method\":\"store\",\"id\":1,\"params\":[[";
+        for (size_t i = 0; request.size() < size; ++i) {
+            if (i != 0) {
+                request += ',';
+            }
+            const std::string n = std::to_string(i);
+            request += "{\"id\":" + n + ",\"name\":\"record " + n + "\",\"score\":" + n + ".5,\"tags\":[\"a\",\"b\"]}";
+        }
+        request += "]]}";
+        return request;
+    }
+
+    void BenchmarkParsing() {
+        std::cout << "-- request parsing\n";
+        for (size_t size : { 100, 10 * 1024, 1024 * 1024, 100 * 1024 * 1024 }) {
+            const std::string request = BuildRequest(size);
+            const std::string suffix = " (" + std::to_string(request.size()) + " B)";
+
+            Measure("JsonReader" + suffix, request.size(), [&]() {
+                jsonrpc::JsonReader(request).GetRequest();
+            });
+            Measure("JsonSaxReader" + suffix, request.size(), [&]() {
+                jsonrpc::JsonSaxReader(request).GetRequest();
+            });
+#ifdef JSONRPC_LEAN_HAS_SIMDJSON
+            Measure("SimdJsonReader" + suffix, request.size(), [&]() {
+                jsonrpc::SimdJsonReader(request).GetRequest();
+            });
+#endif
+        }
+    }
+
+    // A result of count records shaped like the ones in BuildRequest
+    jsonrpc::Value BuildResult(size_t count) {
+        jsonrpc::Value::Array records;
+        records.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            jsonrpc::Value::Struct record;
+            record["id"] = static_cast<int32_t>(i);
+            record["name"] = "record " + std::to_string(i);
+            record["score"] = i + 0.5;
+            jsonrpc::Value::Array tags;
+            tags.emplace_back("a");
+            tags.emplace_back("b");
+            record["tags"] = std::move(tags);
+            records.emplace_back(std::move(record));
+        }
+        return jsonrpc::Value(std::move(records));
+    }
+
+    void BenchmarkWriting() {
+        std::cout << "-- response writing\n";
+        jsonrpc::JsonFormatHandler handler;
+        jsonrpc::JsonFormatHandler exactHandler;
+        exactHandler.SetExactSizing();
+        for (size_t count : { 1, 100, 10000, 1000000 }) {
+            const jsonrpc::Response response(BuildResult(count), jsonrpc::Value(1));
+            const size_t bytes = handler.FormatResponse(response)->GetSize();
+            const std::string suffix = " (" + std::to_string(bytes) + " B)";
+
+            Measure("Writer (virtual)" + suffix, bytes, [&]() {
+                auto writer = handler.CreateWriter();
+                response.Write(*writer);
+                writer->GetData();
+            });
+            Measure("JsonWriter (templated)" + suffix, bytes, [&]() {
+                jsonrpc::JsonWriter writer;
+                response.Write(writer);
+                writer.GetData();
+            });
+            Measure("FormatResponse" + suffix, bytes, [&]() {
+                handler.FormatResponse(response);
+            });
+            Measure("FormatResponse, exact sizing" + suffix, bytes, [&]() {
+                exactHandler.FormatResponse(response);
+            });
+        }
+    }
+
+    void BenchmarkBase64() {
+        std::cout << "-- base64\n";
+        for (size_t size : { 1024, 1024 * 1024, 64 * 1024 * 1024 }) {
+            std::string data(size, '\0');
+            for (size_t i = 0; i < size; ++i) {
+                data[i] = static_cast<char>(i * 2654435761u >> 13);
+            }
+            const std::string suffix = " (" + std::to_string(size) + " B)";
+
+            std::string encoded(jsonrpc::util::Base64EncodedSize(size), '\0');
+            Measure("Base64EncodeTo" + suffix, size, [&]() {
+                jsonrpc::util::Base64EncodeTo(data.data(), data.size(), &encoded[0]);
+            });
+
+            std::string decoded(jsonrpc::util::Base64DecodedMaxSize(encoded.size()), '\0');
+            Measure("Base64DecodeTo" + suffix, size, [&]() {
+                jsonrpc::util::Base64DecodeTo(encoded.data(), encoded.size(), &decoded[0]);
+            });
+
+            Measure("Base64Encode (MIME)" + suffix, size, [&]() {
+                jsonrpc::util::Base64Encode(data);
+            });
+
+            const jsonrpc::Response response(jsonrpc::Value(data, true), jsonrpc::Value(1));
+            Measure("JsonWriter binary result" + suffix, size, [&]() {
+                jsonrpc::JsonWriter writer;
+                response.Write(writer);
+                writer.GetData();
+            });
+        }
+    }
+
+    // At least size bytes of text with one of extras after every period
+    // characters
+    std::string BuildText(size_t size, size_t period, const std::vector<std::string>& extras) {
+        static const char words[] = "lorem ipsum dolor sit amet consectetur adipiscing elit sed do eiusmod tempor ";
+        std::string text;
+        text.reserve(size + 8);
+        for (size_t i = 0; text.size() < size; ++i) {
+            text += words[i % (sizeof(words) - 1)];
+            if (period != 0 && i % period == period - 1) {
+                text += extras[(i / period) % extras.size()];
+            }
+        }
+        return text;
+    }
+
+    void BenchmarkEscaping() {
+        std::cout << "-- string escaping\n";
+        const size_t size = 1024 * 1024;
+        const struct {
+            const char* Name;
+            std::string Text;
+        } corpora[] = {
+            { "ascii", BuildText(size, 0, {}) },
+            { "mixed", BuildText(size, 8, { "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80" }) },
+            { "escape-heavy", BuildText(size, 4, { "\"", "\\", "\n", "\t" }) },
+        };
+
+        for (auto& corpus : corpora) {
+            const std::string& text = corpus.Text;
+            const std::string name = std::string(" (") + corpus.Name + ")";
+
+            Measure("rapidjson::Writer::String" + name, text.size(), [&]() {
+                rapidjson::StringBuffer buffer;
+                rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                writer.String(text.data(), text.size(), true);
+            });
+            Measure("JsonWriter::Write" + name, text.size(), [&]() {
+                jsonrpc::JsonWriter writer;
+                writer.Write(text);
+            });
+            Measure("JsonWriter::Write, UTF-8 validation" + name, text.size(), [&]() {
+                jsonrpc::JsonWriter writer;
+                writer.SetUtf8Validation();
+                writer.Write(text);
+            });
+        }
+    }
+
+    // The same responses through each format, sizes and both directions
+    void BenchmarkFormats() {
+        std::cout << "-- JSON vs MessagePack vs CBOR\n";
+        jsonrpc::JsonFormatHandler json;
+        jsonrpc::MsgPackFormatHandler msgpack;
+        jsonrpc::CborFormatHandler cbor;
+
+        std::string blob(64 * 1024, '\0');
+        for (size_t i = 0; i < blob.size(); ++i) {
+            blob[i] = static_cast<char>(i * 2654435761u >> 13);
+        }
+
+        const struct {
+            std::string Name;
+            jsonrpc::Value Result;
+        } results[] = {
+            { "100 records", BuildResult(100) },
+            { "10000 records", BuildResult(10000) },
+            { "64 KiB binary", jsonrpc::Value(blob, true) },
+            { "100000 doubles", jsonrpc::Value(jsonrpc::Value::DoubleArray(100000, 0.1)) },
+        };
+
+        for (auto& result : results) {
+            const jsonrpc::Response response(jsonrpc::Value(result.Result), jsonrpc::Value(1));
+            const struct {
+                const char* Name;
+                jsonrpc::FormatHandler& Handler;
+            } formats[] = { { "JSON", json }, { "MessagePack", msgpack }, { "CBOR", cbor } };
+
+            for (auto& format : formats) {
+                const auto data = format.Handler.FormatResponse(response);
+                const std::string bytes(data->GetData(), data->GetSize());
+                const std::string suffix = std::string(" ") + format.Name + ", " + result.Name
+                    + " (" + std::to_string(bytes.size()) + " B)";
+
+                Measure("write" + suffix, bytes.size(), [&]() {
+                    format.Handler.FormatResponse(response);
+                });
+                Measure("read" + suffix, bytes.size(), [&]() {
+                    format.Handler.CreateReader(bytes)->GetResponse();
+                });
+            }
+        }
+    }
+
+    void BenchmarkClient() {
+        std::cout << "-- client calls\n";
+        jsonrpc::JsonFormatHandler handler;
+        jsonrpc::Client client(handler);
+        auto add = client.Stub<int(int, int)>("add");
+        auto echo = client.Stub<std::string(const std::string&, const jsonrpc::Value::DoubleArray&)>("echo");
+
+        const std::string text(64, 'x');
+        const jsonrpc::Value::DoubleArray numbers(16, 0.5);
+        const std::string sum = "{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":5}";
+        const size_t addSize = add.BuildRequestData(2, 3)->GetSize();
+        const size_t echoSize = echo.BuildRequestData(text, numbers)->GetSize();
+
+        Measure("BuildRequestData(int, int)", addSize, [&]() {
+            client.BuildRequestData("add", 2, 3);
+        });
+        Measure("Stub<int(int, int)>", addSize, [&]() {
+            add.BuildRequestData(2, 3);
+        });
+        Measure("BuildRequestData(string, doubles)", echoSize, [&]() {
+            client.BuildRequestData("echo", text, numbers);
+        });
+        Measure("Stub<string(string, doubles)>", echoSize, [&]() {
+            echo.BuildRequestData(text, numbers);
+        });
+        Measure("ParseResponse().AsInteger32()", sum.size(), [&]() {
+            client.ParseResponse(sum).GetResult().AsInteger32();
+        });
+        Measure("Stub ParseResponse", sum.size(), [&]() {
+            add.ParseResponse(sum);
+        });
+    }
+
+    void BenchmarkTransport() {
+        std::cout << "-- transport calls\n";
+        jsonrpc::JsonFormatHandler handler;
+        jsonrpc::Server server;
+        server.RegisterFormatHandler(handler);
+        server.GetDispatcher().AddMethod("add", [](int a, int b) { return a + b; });
+
+        jsonrpc::Client client(handler);
+        jsonrpc::ClientTransport json(client, [&](const std::shared_ptr<jsonrpc::FormattedData>& data) {
+            auto response = server.HandleRequest(std::string(data->GetData(), data->GetSize()));
+            return std::string(response->GetData(), response->GetSize());
+        });
+        jsonrpc::LoopbackTransport loopback(server.GetDispatcher());
+        const size_t size = client.BuildRequestData("add", 2, 3)->GetSize();
+
+        Measure("ClientTransport through Server", size, [&]() {
+            json.Call("add", 2, 3).AsInteger32();
+        });
+        Measure("LoopbackTransport", size, [&]() {
+            loopback.Call("add", 2, 3).AsInteger32();
+        });
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string only = argc > 1 ? argv[1] : "";
+
+    if (only.empty() || only == "parse") {
+        BenchmarkParsing();
+    }
+    if (only.empty() || only == "write") {
+        BenchmarkWriting();
+    }
+    if (only.empty() || only == "base64") {
+        BenchmarkBase64();
+    }
+    if (only.empty() || only == "escape") {
+        BenchmarkEscaping();
+    }
+    if (only.empty() || only == "formats") {
+        BenchmarkFormats();
+    }
+    if (only.empty() || only == "client") {
+        BenchmarkClient();
+    }
+    if (only.empty() || only == "transport") {
+        BenchmarkTransport();
+    }
+
+    return 0;
+}
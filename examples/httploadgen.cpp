@@ -0,0 +1,184 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+// A load generator for JSON-RPC over HTTP/1.1. Each client thread keeps one
+// keep-alive connection busy with a pipeline of POST requests calling
+// add(2, 3). Without a port it starts a TcpServer with an HttpFramer to
+// load; with one, it loads whatever listens there on localhost, which
+// must answer with a Content-Length.
+//
+// usage: httploadgen [server threads] [connections] [pipeline depth] [seconds] [port]
+
+#include "../include/jsonrpc-lean/client.h"
+#include "../include/jsonrpc-lean/httpframer.h"
+#include "../include/jsonrpc-lean/jsonformathandler.h"
+#include "../include/jsonrpc-lean/server.h"
+#include "../include/jsonrpc-lean/tcpserver.h"
+
+#include <arpa/inet.h>
+#include <strings.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    int Connect(uint16_t port) {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            std::cerr << "cannot connect to port " << port << std::endl;
+            std::exit(1);
+        }
+        const int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        return fd;
+    }
+
+    // The size of the response at the start of data, or 0 if it is not all
+    // in yet
+    size_t GetResponseSize(const char* data, size_t size) {
+        const char* end = data + size;
+        const char* headerEnd = nullptr;
+        for (const char* c = data; c + 3 < end; ++c) {
+            if (std::memcmp(c, "\r\n\r\n", 4) == 0) {
+                headerEnd = c + 4;
+                break;
+            }
+        }
+        if (headerEnd == nullptr) {
+            return 0;
+        }
+
+        size_t length = 0;
+        for (const char* line = data; line < headerEnd; ++line) {
+            if (line[0] == '\n' && headerEnd - line > 16 && ::strncasecmp(line + 1, "Content-Length:", 15) == 0) {
+                length = std::strtoul(line + 16, nullptr, 10);
+                break;
+            }
+        }
+        if (static_cast<size_t>(end - headerEnd) < length) {
+            return 0;
+        }
+        return headerEnd - data + length;
+    }
+
+    // Sends depth requests at a time and waits for their responses, until
+    // told to stop. Returns the number of calls answered.
+    size_t RunConnection(uint16_t port, size_t depth, const std::atomic<bool>& stop) {
+        jsonrpc::JsonFormatHandler handler;
+        jsonrpc::Client client(handler);
+        const auto body = client.BuildRequestData("add", 2, 3);
+        std::string request = "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\nContent-Length: ";
+        request.append(std::to_string(body->GetSize())).append("\r\n\r\n").append(body->GetData(), body->GetSize());
+        std::string requests;
+        for (size_t i = 0; i < depth; ++i) {
+            requests.append(request);
+        }
+
+        const int fd = Connect(port);
+        std::string input;
+        std::vector<char> buffer(64 * 1024);
+        size_t calls = 0;
+        while (!stop) {
+            for (size_t sent = 0; sent < requests.size();) {
+                const ssize_t size = ::send(fd, requests.data() + sent, requests.size() - sent, MSG_NOSIGNAL);
+                if (size <= 0) {
+                    ::close(fd);
+                    return calls;
+                }
+                sent += static_cast<size_t>(size);
+            }
+            for (size_t answered = 0; answered < depth;) {
+                const ssize_t size = ::recv(fd, buffer.data(), buffer.size(), 0);
+                if (size <= 0) {
+                    ::close(fd);
+                    return calls;
+                }
+                input.append(buffer.data(), static_cast<size_t>(size));
+                size_t start = 0;
+                while (size_t responseSize = GetResponseSize(input.data() + start, input.size() - start)) {
+                    start += responseSize;
+                    ++answered;
+                }
+                input.erase(0, start);
+            }
+            calls += depth;
+        }
+        ::close(fd);
+        return calls;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t serverThreads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2;
+    const size_t connections = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+    const size_t depth = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 16;
+    const double seconds = argc > 4 ? std::atof(argv[4]) : 2;
+    uint16_t port = argc > 5 ? static_cast<uint16_t>(std::strtoul(argv[5], nullptr, 10)) : 0;
+
+    jsonrpc::Server server;
+    jsonrpc::JsonFormatHandler jsonFormatHandler;
+    server.RegisterFormatHandler(jsonFormatHandler);
+    server.GetDispatcher().AddMethod("add", [](int a, int b) { return a + b; });
+
+    std::unique_ptr<jsonrpc::TcpServer> tcpServer;
+    if (port == 0) {
+        jsonrpc::TcpServerOptions options;
+        options.ThreadCount = serverThreads;
+        options.Framers = jsonrpc::HttpFramer::Factory();
+        tcpServer.reset(new jsonrpc::TcpServer(server, options));
+        tcpServer->Start();
+        port = tcpServer->GetPort();
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> calls(0);
+    std::vector<std::thread> clients;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < connections; ++i) {
+        clients.emplace_back([&]() {
+            calls += RunConnection(port, depth, stop);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (tcpServer) {
+        std::cout << serverThreads << " server threads, ";
+    }
+    std::cout << connections << " connections, pipeline depth " << depth << ": "
+        << std::fixed << std::setprecision(0) << calls / elapsed << " calls/s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,151 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; either version 2.1 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+// Measures calls per second through TcpServer over localhost. Each client
+// thread keeps one connection busy with a pipeline of NDJSON requests.
+// Built with liburing, it runs the epoll and the io_uring backends one
+// after the other unless told which.
+//
+// usage: tcpbenchmark [server threads] [connections] [pipeline depth] [seconds] [epoll|io_uring]
+
+#include "../include/jsonrpc-lean/client.h"
+#include "../include/jsonrpc-lean/jsonformathandler.h"
+#include "../include/jsonrpc-lean/server.h"
+#include "../include/jsonrpc-lean/tcpserver.h"
+
+#include <arpa/inet.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    int Connect(uint16_t port) {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            std::cerr << "cannot connect to port " << port << std::endl;
+            std::exit(1);
+        }
+        const int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        return fd;
+    }
+
+    // Sends depth requests at a time and waits for their responses, until
+    // told to stop. Returns the number of calls answered.
+    size_t RunConnection(uint16_t port, size_t depth, const std::atomic<bool>& stop) {
+        jsonrpc::JsonFormatHandler handler;
+        jsonrpc::Client client(handler);
+        const auto request = client.BuildRequestData("add", 2, 3);
+        std::string requests;
+        for (size_t i = 0; i < depth; ++i) {
+            requests.append(request->GetData(), request->GetSize());
+            requests.push_back('\n');
+        }
+
+        const int fd = Connect(port);
+        std::vector<char> buffer(64 * 1024);
+        size_t calls = 0;
+        while (!stop) {
+            for (size_t sent = 0; sent < requests.size();) {
+                const ssize_t size = ::send(fd, requests.data() + sent, requests.size() - sent, MSG_NOSIGNAL);
+                if (size <= 0) {
+                    ::close(fd);
+                    return calls;
+                }
+                sent += static_cast<size_t>(size);
+            }
+            for (size_t answered = 0; answered < depth;) {
+                const ssize_t size = ::recv(fd, buffer.data(), buffer.size(), 0);
+                if (size <= 0) {
+                    ::close(fd);
+                    return calls;
+                }
+                for (ssize_t i = 0; i < size; ++i) {
+                    answered += buffer[i] == '\n';
+                }
+            }
+            calls += depth;
+        }
+        ::close(fd);
+        return calls;
+    }
+
+    void RunBenchmark(jsonrpc::Server& server, jsonrpc::TcpBackend backend, size_t serverThreads,
+        size_t connections, size_t depth, double seconds) {
+        jsonrpc::TcpServerOptions options;
+        options.ThreadCount = serverThreads;
+        options.Backend = backend;
+        jsonrpc::TcpServer tcpServer(server, options);
+        tcpServer.Start();
+
+        std::atomic<bool> stop(false);
+        std::atomic<size_t> calls(0);
+        std::vector<std::thread> clients;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < connections; ++i) {
+            clients.emplace_back([&]() {
+                calls += RunConnection(tcpServer.GetPort(), depth, stop);
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+        for (auto& client : clients) {
+            client.join();
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::left << std::setw(9) << (backend == jsonrpc::TcpBackend::EPOLL ? "epoll" : "io_uring") << std::right
+            << serverThreads << " server threads, " << connections << " connections, pipeline depth "
+            << depth << ": " << std::fixed << std::setprecision(0) << calls / elapsed << " calls/s" << std::endl;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t serverThreads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2;
+    const size_t connections = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+    const size_t depth = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 16;
+    const double seconds = argc > 4 ? std::atof(argv[4]) : 2;
+    const std::string backend = argc > 5 ? argv[5] : "";
+
+    jsonrpc::Server server;
+    jsonrpc::JsonFormatHandler jsonFormatHandler;
+    server.RegisterFormatHandler(jsonFormatHandler);
+    server.GetDispatcher().AddMethod("add", [](int a, int b) { return a + b; });
+
+    if (backend.empty() || backend == "epoll") {
+        RunBenchmark(server, jsonrpc::TcpBackend::EPOLL, serverThreads, connections, depth, seconds);
+    }
+#ifdef JSONRPC_LEAN_HAS_URING
+    if (backend.empty() || backend == "io_uring") {
+        RunBenchmark(server, jsonrpc::TcpBackend::IO_URING, serverThreads, connections, depth, seconds);
+    }
+#endif
+    return 0;
+}
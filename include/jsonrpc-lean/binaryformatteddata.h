@@ -0,0 +1,46 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_BINARYFORMATTEDDATA_H
+#define JSONRPC_LEAN_BINARYFORMATTEDDATA_H
+
+#include "formatteddata.h"
+#include "outputbuffer.h"
+
+#include <string>
+
+namespace jsonrpc {
+
+    // A single buffer, for the binary formats that write straight into one
+    class BinaryFormattedData final : public FormattedData {
+    public:
+        BinaryFormattedData() {}
+
+        // Writes into buffer, reusing its capacity, see JsonFormattedData
+        explicit BinaryFormattedData(std::string buffer) : myBuffer(std::move(buffer)) {}
+
+        const char* GetData() override {
+            return myBuffer.GetString();
+        }
+
+        size_t GetSize() override {
+            return myBuffer.GetSize();
+        }
+
+        std::string ReleaseString() override {
+            return myBuffer.Release();
+        }
+
+        OutputBuffer& GetBuffer() {
+            return myBuffer;
+        }
+
+    private:
+        OutputBuffer myBuffer;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_BINARYFORMATTEDDATA_H
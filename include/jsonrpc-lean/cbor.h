@@ -0,0 +1,73 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_CBOR_H
+#define JSONRPC_LEAN_CBOR_H
+
+#include <cstdint>
+
+namespace jsonrpc {
+    namespace cbor {
+
+        // Major types, the top three bits of an item's initial byte, see
+        // RFC 8949
+        const uint8_t UNSIGNED_INTEGER = 0;
+        const uint8_t NEGATIVE_INTEGER = 1;
+        const uint8_t BYTE_STRING = 2;
+        const uint8_t TEXT_STRING = 3;
+        const uint8_t ARRAY = 4;
+        const uint8_t MAP = 5;
+        const uint8_t TAG = 6;
+        const uint8_t SIMPLE = 7;
+
+        // Additional information, the low five bits
+        const uint8_t DIRECT_MAX = 23;
+        const uint8_t ONE_BYTE = 24;
+        const uint8_t TWO_BYTES = 25;
+        const uint8_t FOUR_BYTES = 26;
+        const uint8_t EIGHT_BYTES = 27;
+        const uint8_t INDEFINITE = 31;
+
+        // Whole initial bytes of major type 7
+        const uint8_t FALSE_VALUE = 0xf4;
+        const uint8_t TRUE_VALUE = 0xf5;
+        const uint8_t NULL_VALUE = 0xf6;
+        const uint8_t UNDEFINED_VALUE = 0xf7;
+        const uint8_t FLOAT16 = 0xf9;
+        const uint8_t FLOAT32 = 0xfa;
+        const uint8_t FLOAT64 = 0xfb;
+        const uint8_t BREAK = 0xff;
+
+        // RFC 8746 typed array tags, a byte string holding the elements
+        // back to back. Tags 64 to 87 encode the element type in their low
+        // bits: float (0x10), signed (0x08), little endian (0x04) and the
+        // element size (0x03), 1 << n bytes for integers and 2 << n bytes for
+        // floats. 8-bit integers have no byte order, 68 is uint8 clamped and
+        // 76 is reserved.
+        const uint64_t TYPED_ARRAY_FIRST = 64;
+        const uint64_t TYPED_ARRAY_LAST = 87;
+        const uint64_t TYPED_ARRAY_FLOAT = 0x10;
+        const uint64_t TYPED_ARRAY_SIGNED = 0x08;
+        const uint64_t TYPED_ARRAY_LITTLE_ENDIAN = 0x04;
+        const uint64_t TYPED_ARRAY_SIZE = 0x03;
+        const uint64_t TYPED_ARRAY_RESERVED = 76;
+
+        const uint64_t SINT32_BIG_ENDIAN = 74;
+        const uint64_t SINT64_BIG_ENDIAN = 75;
+        const uint64_t FLOAT64_BIG_ENDIAN = 82;
+        const uint64_t SINT32_LITTLE_ENDIAN = 78;
+        const uint64_t SINT64_LITTLE_ENDIAN = 79;
+        const uint64_t FLOAT64_LITTLE_ENDIAN = 86;
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        const bool NATIVE_LITTLE_ENDIAN = false;
+#else
+        const bool NATIVE_LITTLE_ENDIAN = true;
+#endif
+
+    } // namespace cbor
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_CBOR_H
@@ -0,0 +1,80 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_CBORFORMATHANDLER_H
+#define JSONRPC_LEAN_CBORFORMATHANDLER_H
+
+#include "formathandler.h"
+#include "cborreader.h"
+#include "cborwriter.h"
+
+#include <memory>
+
+namespace jsonrpc {
+
+    const char APPLICATION_CBOR[] = "application/cbor";
+
+    // JSON-RPC 2.0 messages encoded as CBOR (RFC 8949), see CborWriter
+    class CborFormatHandler : public FormatHandler {
+    public:
+        explicit CborFormatHandler() {}
+
+        // Write numeric arrays as RFC 8746 typed arrays (the default), or as
+        // plain arrays of numbers for peers that don't understand the tags
+        CborFormatHandler& SetTypedArrays(bool typedArrays = true) {
+            myTypedArrays = typedArrays;
+            return *this;
+        }
+
+        bool IsTypedArrays() const { return myTypedArrays; }
+
+        // FormatHandler
+        bool CanHandleRequest(const std::string& contentType) override {
+            return contentType == APPLICATION_CBOR;
+        }
+
+        std::string GetContentType() override {
+            return APPLICATION_CBOR;
+        }
+
+        bool UsesId() override {
+            return true;
+        }
+
+        std::unique_ptr<Reader> CreateReader(const std::string& data) override {
+            return std::unique_ptr<Reader>(std::make_unique<CborReader>(data));
+        }
+
+        std::unique_ptr<Writer> CreateWriter() override {
+            return std::unique_ptr<Writer>(std::make_unique<CborWriter>(myTypedArrays));
+        }
+
+        std::shared_ptr<FormattedData> FormatRequest(const std::string& methodName,
+            const Request::Parameters& params, const Value& id) override {
+            CborWriter writer(myTypedArrays);
+            Request::Write(methodName, params, id, writer);
+            return writer.GetData();
+        }
+
+        std::shared_ptr<FormattedData> FormatRequest(int32_t methodId,
+            const Request::Parameters& params, const Value& id) override {
+            CborWriter writer(myTypedArrays);
+            Request::Write(methodId, params, id, writer);
+            return writer.GetData();
+        }
+
+        std::shared_ptr<FormattedData> FormatResponse(const Response& response) override {
+            CborWriter writer(myTypedArrays);
+            response.Write(writer);
+            return writer.GetData();
+        }
+
+    private:
+        bool myTypedArrays = true;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_CBORFORMATHANDLER_H
@@ -0,0 +1,783 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_CBORREADER_H
+#define JSONRPC_LEAN_CBORREADER_H
+
+#include "reader.h"
+#include "cbor.h"
+#include "fault.h"
+#include "json.h"
+#include "request.h"
+#include "response.h"
+#include "util.h"
+#include "value.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace jsonrpc {
+
+    // Reads what CborWriter writes, or any CBOR map with the same keys, in
+    // definite or indefinite length encoding. Byte strings become BINARY and
+    // text strings STRING. RFC 8746 typed arrays of integers and of 16, 32
+    // and 64-bit floats in either byte order become numeric arrays; other
+    // tags are ignored, leaving the tagged item. Decodes straight from data,
+    // which has to outlive the reader.
+    class CborReader final : public Reader {
+    public:
+        explicit CborReader(const std::string& data)
+            : myBegin(data.data()), myEnd(data.data() + data.size()), myPosition(myBegin) {
+        }
+
+        // Reader
+        Request GetRequest() override {
+            myPosition = myBegin;
+            Container envelope = ReadEnvelope();
+
+            bool hasVersion = false;
+            bool hasMethod = false;
+            bool hasParams = false;
+            bool hasId = false;
+            std::string method;
+            int32_t methodId = -1;
+            Request::Parameters parameters;
+            Value id;
+
+            // First occurrence wins, as with rapidjson's FindMember
+            while (HasNext(envelope)) {
+                switch (ReadKey()) {
+                case Member::JSONRPC:
+                    if (!hasVersion) {
+                        ValidateJsonrpcVersion();
+                        hasVersion = true;
+                        continue;
+                    }
+                    break;
+                case Member::METHOD:
+                    if (!hasMethod) {
+                        ReadMethod(method, methodId);
+                        hasMethod = true;
+                        continue;
+                    }
+                    break;
+                case Member::PARAMS:
+                    if (!hasParams) {
+                        parameters = ReadParameters();
+                        hasParams = true;
+                        continue;
+                    }
+                    break;
+                case Member::ID:
+                    if (!hasId) {
+                        id = ReadId();
+                        hasId = true;
+                        continue;
+                    }
+                    break;
+                default:
+                    break;
+                }
+                ReadValue(0);
+            }
+            CheckEnd();
+
+            if (!hasVersion || !hasMethod) {
+                throw InvalidRequestFault();
+            }
+
+            if (!hasId) {
+                // Notification
+                id = false;
+            }
+
+            if (methodId >= 0) {
+                return Request(methodId, std::move(parameters), std::move(id));
+            }
+            return Request(std::move(method), std::move(parameters), std::move(id));
+        }
+
+        Response GetResponse() override {
+            myPosition = myBegin;
+            Response response = ReadResponse();
+            CheckEnd();
+            return response;
+        }
+
+        Value GetValue() override {
+            myPosition = myBegin;
+            Value value = ReadValue(0);
+            CheckEnd();
+            return value;
+        }
+
+    private:
+        enum class Member {
+            OTHER,
+            JSONRPC,
+            METHOD,
+            PARAMS,
+            ID,
+            RESULT,
+            FAULT
+        };
+
+        // An array or map being read, Size counts the elements or entries
+        // left in a definite one
+        struct Container {
+            uint64_t Size;
+            bool Indefinite;
+        };
+
+        // Deeper nesting is rejected rather than risking the stack
+        static const size_t MAX_DEPTH = 512;
+
+        static void ThrowParseError(const char* reason) {
+            throw ParseErrorFault(std::string("Parse error: ") + reason);
+        }
+
+        const char* ReadBytes(uint64_t size) {
+            if (static_cast<uint64_t>(myEnd - myPosition) < size) {
+                ThrowParseError("unexpected end of data");
+            }
+            const char* const bytes = myPosition;
+            myPosition += size;
+            return bytes;
+        }
+
+        uint8_t PeekByte() const {
+            if (myPosition == myEnd) {
+                ThrowParseError("unexpected end of data");
+            }
+            return static_cast<uint8_t>(*myPosition);
+        }
+
+        void CheckEnd() const {
+            if (myPosition != myEnd) {
+                ThrowParseError("trailing data");
+            }
+        }
+
+        // Consumes an initial byte and its argument, returning the major
+        // type. Indefinite lengths have an argument of 0.
+        uint8_t ReadHead(uint64_t& argument, bool& indefinite) {
+            const uint8_t initial = static_cast<uint8_t>(*ReadBytes(1));
+            const uint8_t majorType = initial >> 5;
+            const uint8_t info = initial & 0x1f;
+            indefinite = false;
+            if (info <= cbor::DIRECT_MAX) {
+                argument = info;
+            } else if (info == cbor::ONE_BYTE) {
+                argument = static_cast<uint8_t>(*ReadBytes(1));
+            } else if (info == cbor::TWO_BYTES) {
+                argument = util::LoadBigEndian16(ReadBytes(2));
+            } else if (info == cbor::FOUR_BYTES) {
+                argument = util::LoadBigEndian32(ReadBytes(4));
+            } else if (info == cbor::EIGHT_BYTES) {
+                argument = util::LoadBigEndian64(ReadBytes(8));
+            } else if (info == cbor::INDEFINITE && majorType >= cbor::BYTE_STRING && majorType != cbor::TAG) {
+                argument = 0;
+                indefinite = true;
+            } else {
+                ThrowParseError("malformed initial byte");
+            }
+            return majorType;
+        }
+
+        // Whether the container has another item, consuming the break that
+        // ends an indefinite one
+        bool HasNext(Container& container) {
+            if (container.Indefinite) {
+                if (PeekByte() == cbor::BREAK) {
+                    ++myPosition;
+                    return false;
+                }
+                return true;
+            }
+            if (container.Size == 0) {
+                return false;
+            }
+            --container.Size;
+            return true;
+        }
+
+        // Every element takes at least one byte and every entry two, which
+        // bounds what a corrupt head can make the reader reserve
+        Container StartContainer(uint8_t majorType, uint64_t size, bool indefinite) const {
+            const uint64_t minSize = majorType == cbor::MAP ? 2 : 1;
+            if (!indefinite && size > static_cast<uint64_t>(myEnd - myPosition) / minSize) {
+                ThrowParseError("unexpected end of data");
+            }
+            return Container{ size, indefinite };
+        }
+
+        // The bytes of a byte or text string of majorType whose head has
+        // been read. Definite strings are returned in place, the chunks of
+        // indefinite ones are joined in storage.
+        const char* ReadStringBytes(uint8_t majorType, uint64_t size, bool indefinite,
+            size_t& length, std::string& storage) {
+            if (!indefinite) {
+                length = static_cast<size_t>(size);
+                return ReadBytes(size);
+            }
+            while (PeekByte() != cbor::BREAK) {
+                uint64_t chunkSize;
+                bool chunkIndefinite;
+                if (ReadHead(chunkSize, chunkIndefinite) != majorType || chunkIndefinite) {
+                    ThrowParseError("malformed string chunk");
+                }
+                const char* const chunk = ReadBytes(chunkSize);
+                storage.append(chunk, static_cast<size_t>(chunkSize));
+            }
+            ++myPosition;
+            length = storage.size();
+            return storage.data();
+        }
+
+        bool IsText() const {
+            return PeekByte() >> 5 == cbor::TEXT_STRING;
+        }
+
+        std::string ReadText() {
+            if (!IsText()) {
+                throw InvalidRequestFault();
+            }
+            uint64_t size;
+            bool indefinite;
+            const uint8_t majorType = ReadHead(size, indefinite);
+            std::string storage;
+            size_t length;
+            const char* const text = ReadStringBytes(majorType, size, indefinite, length, storage);
+            return text == storage.data() ? std::move(storage) : std::string(text, length);
+        }
+
+        Container ReadEnvelope() {
+            if (PeekByte() >> 5 != cbor::MAP) {
+                throw InvalidRequestFault();
+            }
+            uint64_t size;
+            bool indefinite;
+            ReadHead(size, indefinite);
+            return StartContainer(cbor::MAP, size, indefinite);
+        }
+
+        // Consumes the key of an envelope member, keys that are not text are
+        // OTHER
+        Member ReadKey() {
+            if (!IsText()) {
+                ReadValue(0);
+                return Member::OTHER;
+            }
+            const std::string key = ReadText();
+            if (key == json::JSONRPC_NAME) {
+                return Member::JSONRPC;
+            } else if (key == json::METHOD_NAME) {
+                return Member::METHOD;
+            } else if (key == json::PARAMS_NAME) {
+                return Member::PARAMS;
+            } else if (key == json::ID_NAME) {
+                return Member::ID;
+            } else if (key == json::RESULT_NAME) {
+                return Member::RESULT;
+            } else if (key == json::ERROR_NAME) {
+                return Member::FAULT;
+            }
+            return Member::OTHER;
+        }
+
+        void ValidateJsonrpcVersion() {
+            if (ReadText() != json::JSONRPC_VERSION_2_0) {
+                throw InvalidRequestFault();
+            }
+        }
+
+        Container ReadArrayHead() {
+            if (PeekByte() >> 5 != cbor::ARRAY) {
+                throw InvalidRequestFault();
+            }
+            uint64_t size;
+            bool indefinite;
+            ReadHead(size, indefinite);
+            return StartContainer(cbor::ARRAY, size, indefinite);
+        }
+
+        // A response map starting at the current position
+        Response ReadResponse() {
+            Container envelope = ReadEnvelope();
+
+            bool hasVersion = false;
+            bool hasId = false;
+            bool hasResult = false;
+            bool hasError = false;
+            Value id;
+            Value result;
+            int32_t code = 0;
+            std::string message;
+
+            while (HasNext(envelope)) {
+                switch (ReadKey()) {
+                case Member::JSONRPC:
+                    if (!hasVersion) {
+                        ValidateJsonrpcVersion();
+                        hasVersion = true;
+                        continue;
+                    }
+                    break;
+                case Member::ID:
+                    if (!hasId) {
+                        id = ReadId();
+                        hasId = true;
+                        continue;
+                    }
+                    break;
+                case Member::RESULT:
+                    if (!hasResult) {
+                        result = ReadValue(0);
+                        hasResult = true;
+                        continue;
+                    }
+                    break;
+                case Member::FAULT:
+                    if (!hasError) {
+                        ReadError(code, message);
+                        hasError = true;
+                        continue;
+                    }
+                    break;
+                default:
+                    break;
+                }
+                ReadValue(0);
+            }
+
+            if (!hasVersion || !hasId || hasResult == hasError) {
+                throw InvalidRequestFault();
+            }
+
+            if (hasResult) {
+                return Response(std::move(result), std::move(id));
+            }
+            return Response(code, std::move(message), std::move(id));
+        }
+
+        Request::Parameters ReadParameters() {
+            Container params = ReadArrayHead();
+
+            Request::Parameters parameters;
+            while (HasNext(params)) {
+                parameters.emplace_back(ReadValue(1));
+            }
+            return parameters;
+        }
+
+        // The method name, or the id standing in for it, see
+        // Dispatcher::EnableMethodIds
+        void ReadMethod(std::string& name, int32_t& methodId) {
+            if (IsText()) {
+                name = ReadText();
+                return;
+            }
+
+            int64_t integer;
+            double number;
+            if (ReadNumber(integer, number) != Value::Type::INTEGER_64
+                || integer < 0 || integer > std::numeric_limits<int32_t>::max()) {
+                throw InvalidRequestFault();
+            }
+            methodId = static_cast<int32_t>(integer);
+        }
+
+        Value ReadId() {
+            if (PeekByte() == cbor::NULL_VALUE) {
+                ++myPosition;
+                return{};
+            }
+            if (IsText()) {
+                return Value(ReadText());
+            }
+
+            int64_t integer;
+            double number;
+            if (ReadNumber(integer, number) != Value::Type::INTEGER_64) {
+                throw InvalidRequestFault();
+            }
+            return GetInteger(integer);
+        }
+
+        void ReadError(int32_t& code, std::string& message) {
+            if (PeekByte() >> 5 != cbor::MAP) {
+                throw InvalidRequestFault();
+            }
+            uint64_t size;
+            bool indefinite;
+            ReadHead(size, indefinite);
+            Container error = StartContainer(cbor::MAP, size, indefinite);
+
+            bool hasCode = false;
+            bool hasMessage = false;
+            while (HasNext(error)) {
+                if (IsText()) {
+                    const std::string key = ReadText();
+                    if (key == json::ERROR_CODE_NAME && !hasCode) {
+                        int64_t integer;
+                        double number;
+                        if (ReadNumber(integer, number) != Value::Type::INTEGER_64
+                            || integer < std::numeric_limits<int32_t>::min()
+                            || integer > std::numeric_limits<int32_t>::max()) {
+                            throw InvalidRequestFault();
+                        }
+                        code = static_cast<int32_t>(integer);
+                        hasCode = true;
+                        continue;
+                    } else if (key == json::ERROR_MESSAGE_NAME && !hasMessage) {
+                        message = ReadText();
+                        hasMessage = true;
+                        continue;
+                    }
+                } else {
+                    ReadValue(0);
+                }
+                ReadValue(0);
+            }
+            if (!hasCode || !hasMessage) {
+                throw InvalidRequestFault();
+            }
+        }
+
+        static Value GetInteger(int64_t value) {
+            if (value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max()) {
+                return Value(static_cast<int32_t>(value));
+            }
+            return Value(value);
+        }
+
+        static double HalfToDouble(uint16_t half) {
+            const int exponent = (half >> 10) & 0x1f;
+            const int mantissa = half & 0x3ff;
+            double value;
+            if (exponent == 0) {
+                value = std::ldexp(mantissa, -24);
+            } else if (exponent != 31) {
+                value = std::ldexp(mantissa + 1024, exponent - 25);
+            } else {
+                value = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+            }
+            return half & 0x8000 ? -value : value;
+        }
+
+        // Consumes a number, returning INTEGER_64 with integer set, DOUBLE
+        // with number set, or NIL without consuming anything if the next
+        // item is not a number. Integers outside the int64_t range are
+        // doubles, as with the JSON readers.
+        Value::Type ReadNumber(int64_t& integer, double& number) {
+            const uint8_t initial = PeekByte();
+            const uint8_t majorType = initial >> 5;
+            if (majorType == cbor::UNSIGNED_INTEGER || majorType == cbor::NEGATIVE_INTEGER) {
+                uint64_t argument;
+                bool indefinite;
+                ReadHead(argument, indefinite);
+                if (argument > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                    number = majorType == cbor::UNSIGNED_INTEGER
+                        ? static_cast<double>(argument) : -1 - static_cast<double>(argument);
+                    return Value::Type::DOUBLE;
+                }
+                integer = majorType == cbor::UNSIGNED_INTEGER
+                    ? static_cast<int64_t>(argument) : -1 - static_cast<int64_t>(argument);
+                return Value::Type::INTEGER_64;
+            }
+
+            switch (initial) {
+            case cbor::FLOAT16:
+                ++myPosition;
+                number = HalfToDouble(util::LoadBigEndian16(ReadBytes(2)));
+                return Value::Type::DOUBLE;
+            case cbor::FLOAT32: {
+                ++myPosition;
+                const uint32_t bits = util::LoadBigEndian32(ReadBytes(4));
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                number = value;
+                return Value::Type::DOUBLE;
+            }
+            case cbor::FLOAT64: {
+                ++myPosition;
+                const uint64_t bits = util::LoadBigEndian64(ReadBytes(8));
+                memcpy(&number, &bits, sizeof(number));
+                return Value::Type::DOUBLE;
+            }
+            default:
+                return Value::Type::NIL;
+            }
+        }
+
+        Value ReadValue(size_t depth) {
+            if (depth > MAX_DEPTH) {
+                ThrowParseError("nesting too deep");
+            }
+
+            int64_t integer;
+            double number;
+            switch (ReadNumber(integer, number)) {
+            case Value::Type::INTEGER_64:
+                return GetInteger(integer);
+            case Value::Type::DOUBLE:
+                return Value(number);
+            default:
+                break;
+            }
+
+            const uint8_t initial = PeekByte();
+            uint64_t argument;
+            bool indefinite;
+            switch (ReadHead(argument, indefinite)) {
+            case cbor::BYTE_STRING:
+            case cbor::TEXT_STRING: {
+                std::string storage;
+                size_t length;
+                const char* const bytes = ReadStringBytes(initial >> 5, argument, indefinite, length, storage);
+                std::string data = bytes == storage.data() ? std::move(storage) : std::string(bytes, length);
+                return Value(std::move(data), initial >> 5 == cbor::BYTE_STRING);
+            }
+            case cbor::ARRAY:
+                return ReadArray(StartContainer(cbor::ARRAY, argument, indefinite), depth);
+            case cbor::MAP:
+                return ReadStruct(StartContainer(cbor::MAP, argument, indefinite), depth);
+            case cbor::TAG:
+                if (argument >= cbor::TYPED_ARRAY_FIRST && argument <= cbor::TYPED_ARRAY_LAST) {
+                    return ReadTypedArray(argument);
+                }
+                return ReadValue(depth + 1);
+            default:
+                break;
+            }
+
+            switch (initial) {
+            case cbor::FALSE_VALUE:
+                return Value(false);
+            case cbor::TRUE_VALUE:
+                return Value(true);
+            case cbor::NULL_VALUE:
+            case cbor::UNDEFINED_VALUE:
+                return Value();
+            default:
+                break;
+            }
+
+            ThrowParseError("unsupported CBOR item");
+            return{};
+        }
+
+        Value ReadStruct(Container map, size_t depth) {
+            Value::Struct data;
+            while (HasNext(map)) {
+                if (!IsText()) {
+                    ThrowParseError("map key is not a text string");
+                }
+                std::string name = ReadText();
+                data.emplace(std::move(name), ReadValue(depth + 1));
+            }
+            return Value(std::move(data));
+        }
+
+        // Non-empty arrays holding only numbers are stored contiguously, see
+        // JsonReader. They are classified in a first pass over the numbers,
+        // which stops at the first item that is not one.
+        Value ReadArray(Container array, size_t depth) {
+            const char* const start = myPosition;
+            const Container first = array;
+
+            auto type = Value::Type::INTEGER_32_ARRAY;
+            size_t size = 0;
+            while (type != Value::Type::ARRAY && HasNext(array)) {
+                int64_t integer;
+                double number;
+                switch (ReadNumber(integer, number)) {
+                case Value::Type::INTEGER_64:
+                    if (type == Value::Type::INTEGER_32_ARRAY
+                        && (integer < std::numeric_limits<int32_t>::min() || integer > std::numeric_limits<int32_t>::max())) {
+                        type = Value::Type::INTEGER_64_ARRAY;
+                    }
+                    ++size;
+                    break;
+                case Value::Type::DOUBLE:
+                    type = Value::Type::DOUBLE_ARRAY;
+                    ++size;
+                    break;
+                default:
+                    type = Value::Type::ARRAY;
+                    break;
+                }
+            }
+            if (size == 0) {
+                type = Value::Type::ARRAY;
+            }
+            myPosition = start;
+            array = first;
+
+            int64_t integer;
+            double number;
+            switch (type) {
+            case Value::Type::INTEGER_32_ARRAY: {
+                Value::Integer32Array values;
+                values.reserve(size);
+                while (HasNext(array)) {
+                    ReadNumber(integer, number);
+                    values.push_back(static_cast<int32_t>(integer));
+                }
+                return Value(std::move(values));
+            }
+            case Value::Type::INTEGER_64_ARRAY: {
+                Value::Integer64Array values;
+                values.reserve(size);
+                while (HasNext(array)) {
+                    ReadNumber(integer, number);
+                    values.push_back(integer);
+                }
+                return Value(std::move(values));
+            }
+            case Value::Type::DOUBLE_ARRAY: {
+                Value::DoubleArray values;
+                values.reserve(size);
+                while (HasNext(array)) {
+                    values.push_back(ReadNumber(integer, number) == Value::Type::DOUBLE
+                        ? number : static_cast<double>(integer));
+                }
+                return Value(std::move(values));
+            }
+            default: {
+                Value::Array values;
+                if (!array.Indefinite) {
+                    values.reserve(static_cast<size_t>(array.Size));
+                }
+                while (HasNext(array)) {
+                    values.emplace_back(ReadValue(depth + 1));
+                }
+                return Value(std::move(values));
+            }
+            }
+        }
+
+        // One element of a typed array as an unsigned integer of its width
+        static uint64_t LoadElement(const char* data, size_t size, bool littleEndian) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; ++i) {
+                value = value << 8 | static_cast<uint8_t>(data[littleEndian ? size - 1 - i : i]);
+            }
+            return value;
+        }
+
+        template<typename T>
+        static std::vector<T> CopyNative(const char* data, size_t count) {
+            std::vector<T> values(count);
+            if (count != 0) {
+                memcpy(&values[0], data, count * sizeof(T));
+            }
+            return values;
+        }
+
+        Value ReadTypedArray(uint64_t tag) {
+            if (PeekByte() >> 5 != cbor::BYTE_STRING) {
+                ThrowParseError("typed array is not a byte string");
+            }
+            uint64_t argument;
+            bool indefinite;
+            ReadHead(argument, indefinite);
+            std::string storage;
+            size_t length;
+            const char* const data = ReadStringBytes(cbor::BYTE_STRING, argument, indefinite, length, storage);
+
+            const bool isFloat = (tag & cbor::TYPED_ARRAY_FLOAT) != 0;
+            const bool isSigned = (tag & cbor::TYPED_ARRAY_SIGNED) != 0;
+            const bool littleEndian = (tag & cbor::TYPED_ARRAY_LITTLE_ENDIAN) != 0;
+            const size_t elementSize = isFloat ? size_t(2) << (tag & cbor::TYPED_ARRAY_SIZE) : size_t(1) << (tag & cbor::TYPED_ARRAY_SIZE);
+            if (tag == cbor::TYPED_ARRAY_RESERVED || elementSize > 8) {
+                ThrowParseError("unsupported typed array");
+            }
+            if (length % elementSize != 0) {
+                ThrowParseError("typed array length is not a multiple of its element size");
+            }
+            const size_t count = length / elementSize;
+            const bool native = elementSize == 1 || littleEndian == cbor::NATIVE_LITTLE_ENDIAN;
+
+            if (isFloat) {
+                if (native && elementSize == sizeof(double)) {
+                    return Value(CopyNative<double>(data, count));
+                }
+                Value::DoubleArray values;
+                values.reserve(count);
+                for (size_t i = 0; i < count; ++i) {
+                    const uint64_t bits = LoadElement(data + i * elementSize, elementSize, littleEndian);
+                    if (elementSize == 2) {
+                        values.push_back(HalfToDouble(static_cast<uint16_t>(bits)));
+                    } else if (elementSize == 4) {
+                        const uint32_t bits32 = static_cast<uint32_t>(bits);
+                        float value;
+                        memcpy(&value, &bits32, sizeof(value));
+                        values.push_back(value);
+                    } else {
+                        double value;
+                        memcpy(&value, &bits, sizeof(value));
+                        values.push_back(value);
+                    }
+                }
+                return Value(std::move(values));
+            }
+
+            // Sign extended from the element's width
+            const unsigned shift = static_cast<unsigned>(64 - elementSize * 8);
+            const auto element = [&](size_t i) {
+                const uint64_t bits = LoadElement(data + i * elementSize, elementSize, littleEndian);
+                return isSigned ? static_cast<int64_t>(bits << shift) >> shift : static_cast<int64_t>(bits);
+            };
+
+            if (elementSize < 4 || (isSigned && elementSize == 4)) {
+                if (native && isSigned && elementSize == sizeof(int32_t)) {
+                    return Value(CopyNative<int32_t>(data, count));
+                }
+                Value::Integer32Array values;
+                values.reserve(count);
+                for (size_t i = 0; i < count; ++i) {
+                    values.push_back(static_cast<int32_t>(element(i)));
+                }
+                return Value(std::move(values));
+            }
+
+            if (native && isSigned && elementSize == sizeof(int64_t)) {
+                return Value(CopyNative<int64_t>(data, count));
+            }
+
+            // uint64 elements above the int64_t range make it a double array
+            bool fits = true;
+            for (size_t i = 0; i < count && !isSigned && elementSize == 8; ++i) {
+                fits = fits && LoadElement(data + i * 8, 8, littleEndian) <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+            }
+            if (!fits) {
+                Value::DoubleArray values;
+                values.reserve(count);
+                for (size_t i = 0; i < count; ++i) {
+                    values.push_back(static_cast<double>(LoadElement(data + i * 8, 8, littleEndian)));
+                }
+                return Value(std::move(values));
+            }
+
+            Value::Integer64Array values;
+            values.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                values.push_back(element(i));
+            }
+            return Value(std::move(values));
+        }
+
+        const char* myBegin;
+        const char* myEnd;
+        const char* myPosition;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_CBORREADER_H
@@ -0,0 +1,359 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_CBORWRITER_H
+#define JSONRPC_LEAN_CBORWRITER_H
+
+#include "writer.h"
+#include "binaryformatteddata.h"
+#include "cbor.h"
+#include "json.h"
+#include "util.h"
+#include "value.h"
+
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace jsonrpc {
+
+    // Writes the JSON-RPC envelope as a CBOR map with the same keys
+    // JsonWriter uses. Containers with a size hint get a definite length,
+    // the others (request params among them) an indefinite one closed by a
+    // break, so nothing is ever patched in afterwards. BINARY values become
+    // byte strings and numeric arrays RFC 8746 typed arrays in the host's
+    // byte order, unless typed arrays are turned off.
+    class CborWriter final : public Writer {
+    public:
+        explicit CborWriter(bool typedArrays = true)
+            : myRequestData(new BinaryFormattedData()),
+            myBuffer(myRequestData->GetBuffer()),
+            myTypedArrays(typedArrays) {
+            myIndefinite.reserve(16);
+        }
+
+        // Writes into a transport supplied buffer, see BinaryFormattedData
+        explicit CborWriter(std::string buffer, bool typedArrays = true)
+            : myRequestData(new BinaryFormattedData(std::move(buffer))),
+            myBuffer(myRequestData->GetBuffer()),
+            myTypedArrays(typedArrays) {
+            myIndefinite.reserve(16);
+        }
+
+        // Writer
+        std::shared_ptr<FormattedData> GetData() override {
+            return std::static_pointer_cast<FormattedData>(myRequestData);
+        }
+
+        void StartDocument() override {
+            // Empty
+        }
+
+        void EndDocument() override {
+            // Empty
+        }
+
+        void StartRequest(const std::string& methodName, const Value& id) override {
+            WriteHead(cbor::MAP, HasId(id) ? 4 : 3);
+
+            WriteVersion();
+
+            WriteText(json::METHOD_NAME, sizeof(json::METHOD_NAME) - 1);
+            WriteText(methodName.data(), methodName.size());
+
+            WriteId(id);
+
+            WriteText(json::PARAMS_NAME, sizeof(json::PARAMS_NAME) - 1);
+            myBuffer.Put(static_cast<char>(cbor::ARRAY << 5 | cbor::INDEFINITE));
+        }
+
+        void StartRequestById(int32_t methodId, const Value& id) override {
+            WriteHead(cbor::MAP, HasId(id) ? 4 : 3);
+
+            WriteVersion();
+
+            WriteText(json::METHOD_NAME, sizeof(json::METHOD_NAME) - 1);
+            WriteInteger(methodId);
+
+            WriteId(id);
+
+            WriteText(json::PARAMS_NAME, sizeof(json::PARAMS_NAME) - 1);
+            myBuffer.Put(static_cast<char>(cbor::ARRAY << 5 | cbor::INDEFINITE));
+        }
+
+        void EndRequest() override {
+            myBuffer.Put(static_cast<char>(cbor::BREAK));
+        }
+
+        void StartParameter() override {
+            // Empty
+        }
+
+        void EndParameter() override {
+            // Empty
+        }
+
+        void StartResponse(const Value& id) override {
+            WriteHead(cbor::MAP, HasId(id) ? 3 : 2);
+
+            WriteVersion();
+
+            WriteId(id);
+
+            WriteText(json::RESULT_NAME, sizeof(json::RESULT_NAME) - 1);
+        }
+
+        void EndResponse() override {
+            // Empty
+        }
+
+        void StartFaultResponse(const Value& id) override {
+            WriteHead(cbor::MAP, HasId(id) ? 3 : 2);
+
+            WriteVersion();
+
+            WriteId(id);
+        }
+
+        void EndFaultResponse() override {
+            // Empty
+        }
+
+        void WriteFault(int32_t code, const std::string& string) override {
+            WriteText(json::ERROR_NAME, sizeof(json::ERROR_NAME) - 1);
+            WriteHead(cbor::MAP, 2);
+
+            WriteText(json::ERROR_CODE_NAME, sizeof(json::ERROR_CODE_NAME) - 1);
+            WriteInteger(code);
+
+            WriteText(json::ERROR_MESSAGE_NAME, sizeof(json::ERROR_MESSAGE_NAME) - 1);
+            WriteText(string.data(), string.size());
+        }
+
+        void StartArray() override {
+            myBuffer.Put(static_cast<char>(cbor::ARRAY << 5 | cbor::INDEFINITE));
+            myIndefinite.push_back(true);
+        }
+
+        void StartSizedArray(size_t size) override {
+            WriteHead(cbor::ARRAY, size);
+            myIndefinite.push_back(false);
+        }
+
+        void EndArray() override {
+            EndContainer();
+        }
+
+        void StartStruct() override {
+            myBuffer.Put(static_cast<char>(cbor::MAP << 5 | cbor::INDEFINITE));
+            myIndefinite.push_back(true);
+        }
+
+        void StartSizedStruct(size_t size) override {
+            WriteHead(cbor::MAP, size);
+            myIndefinite.push_back(false);
+        }
+
+        void EndStruct() override {
+            EndContainer();
+        }
+
+        void StartStructElement(const std::string& name) override {
+            WriteText(name.data(), name.size());
+        }
+
+        void EndStructElement() override {
+            // Empty
+        }
+
+        void WriteBinary(const char* data, size_t size) override {
+            WriteHead(cbor::BYTE_STRING, size);
+            myBuffer.Append(data, size);
+        }
+
+        void WriteNull() override {
+            myBuffer.Put(static_cast<char>(cbor::NULL_VALUE));
+        }
+
+        void Write(bool value) override {
+            myBuffer.Put(static_cast<char>(value ? cbor::TRUE_VALUE : cbor::FALSE_VALUE));
+        }
+
+        void Write(double value) override {
+            char* const out = myBuffer.Push(9);
+            myBuffer.Pop(out + 9 - EncodeDouble(value, out));
+        }
+
+        void Write(int32_t value) override {
+            WriteInteger(value);
+        }
+
+        void Write(int64_t value) override {
+            WriteInteger(value);
+        }
+
+        void Write(const std::string& value) override {
+            WriteText(value.data(), value.size());
+        }
+
+        void WriteArray(const int32_t* values, size_t size) override {
+            if (myTypedArrays) {
+                WriteTypedArray(values, size, cbor::NATIVE_LITTLE_ENDIAN ? cbor::SINT32_LITTLE_ENDIAN : cbor::SINT32_BIG_ENDIAN);
+                return;
+            }
+            WriteNumberArray(values, size, 9, [](int32_t value, char* out) {
+                return EncodeInteger(value, out);
+            });
+        }
+
+        void WriteArray(const int64_t* values, size_t size) override {
+            if (myTypedArrays) {
+                WriteTypedArray(values, size, cbor::NATIVE_LITTLE_ENDIAN ? cbor::SINT64_LITTLE_ENDIAN : cbor::SINT64_BIG_ENDIAN);
+                return;
+            }
+            WriteNumberArray(values, size, 9, [](int64_t value, char* out) {
+                return EncodeInteger(value, out);
+            });
+        }
+
+        void WriteArray(const double* values, size_t size) override {
+            if (myTypedArrays) {
+                WriteTypedArray(values, size, cbor::NATIVE_LITTLE_ENDIAN ? cbor::FLOAT64_LITTLE_ENDIAN : cbor::FLOAT64_BIG_ENDIAN);
+                return;
+            }
+            WriteNumberArray(values, size, 9, [](double value, char* out) {
+                return EncodeDouble(value, out);
+            });
+        }
+
+    private:
+        // The most any single write reserves in the buffer up front
+        static const size_t MAX_RESERVE = 8 * 1024;
+
+        // The initial byte and the argument in as few bytes as hold it, at
+        // most 9 bytes
+        static char* EncodeHead(uint8_t majorType, uint64_t argument, char* out) {
+            const uint8_t major = static_cast<uint8_t>(majorType << 5);
+            if (argument <= cbor::DIRECT_MAX) {
+                *out++ = static_cast<char>(major | argument);
+            } else if (argument <= 0xff) {
+                *out++ = static_cast<char>(major | cbor::ONE_BYTE);
+                *out++ = static_cast<char>(argument);
+            } else if (argument <= 0xffff) {
+                *out++ = static_cast<char>(major | cbor::TWO_BYTES);
+                out = util::StoreBigEndian(out, static_cast<uint16_t>(argument));
+            } else if (argument <= 0xffffffff) {
+                *out++ = static_cast<char>(major | cbor::FOUR_BYTES);
+                out = util::StoreBigEndian(out, static_cast<uint32_t>(argument));
+            } else {
+                *out++ = static_cast<char>(major | cbor::EIGHT_BYTES);
+                out = util::StoreBigEndian(out, argument);
+            }
+            return out;
+        }
+
+        static char* EncodeInteger(int64_t value, char* out) {
+            if (value >= 0) {
+                return EncodeHead(cbor::UNSIGNED_INTEGER, static_cast<uint64_t>(value), out);
+            }
+            // -1 - value, without overflowing for the smallest int64_t
+            return EncodeHead(cbor::NEGATIVE_INTEGER, ~static_cast<uint64_t>(value), out);
+        }
+
+        // As a float32 when that loses nothing, a float64 otherwise
+        static char* EncodeDouble(double value, char* out) {
+            const double floatMax = std::numeric_limits<float>::max();
+            const float narrow = value >= -floatMax && value <= floatMax ? static_cast<float>(value) : 0;
+            if (static_cast<double>(narrow) == value) {
+                uint32_t bits;
+                memcpy(&bits, &narrow, sizeof(bits));
+                *out++ = static_cast<char>(cbor::FLOAT32);
+                return util::StoreBigEndian(out, bits);
+            }
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            *out++ = static_cast<char>(cbor::FLOAT64);
+            return util::StoreBigEndian(out, bits);
+        }
+
+        void WriteHead(uint8_t majorType, uint64_t argument) {
+            char* const out = myBuffer.Push(9);
+            myBuffer.Pop(out + 9 - EncodeHead(majorType, argument, out));
+        }
+
+        void WriteInteger(int64_t value) {
+            char* const out = myBuffer.Push(9);
+            myBuffer.Pop(out + 9 - EncodeInteger(value, out));
+        }
+
+        void WriteText(const char* data, size_t size) {
+            WriteHead(cbor::TEXT_STRING, size);
+            myBuffer.Append(data, size);
+        }
+
+        void WriteVersion() {
+            WriteText(json::JSONRPC_NAME, sizeof(json::JSONRPC_NAME) - 1);
+            WriteText(json::JSONRPC_VERSION_2_0, sizeof(json::JSONRPC_VERSION_2_0) - 1);
+        }
+
+        static bool HasId(const Value& id) {
+            return id.IsString() || id.IsInteger32() || id.IsInteger64() || id.IsNil();
+        }
+
+        void WriteId(const Value& id) {
+            if (HasId(id)) {
+                WriteText(json::ID_NAME, sizeof(json::ID_NAME) - 1);
+                if (id.IsString()) {
+                    WriteText(id.AsString().data(), id.AsString().size());
+                } else if (id.IsInteger32() || id.IsInteger64()) {
+                    WriteInteger(id.AsInteger64());
+                } else {
+                    WriteNull();
+                }
+            }
+        }
+
+        void EndContainer() {
+            if (myIndefinite.back()) {
+                myBuffer.Put(static_cast<char>(cbor::BREAK));
+            }
+            myIndefinite.pop_back();
+        }
+
+        // The elements as they are in memory, behind the tag for their type
+        // in the host's byte order
+        template<typename T>
+        void WriteTypedArray(const T* values, size_t size, uint64_t tag) {
+            WriteHead(cbor::TAG, tag);
+            WriteBinary(reinterpret_cast<const char*>(values), size * sizeof(T));
+        }
+
+        template<typename T, typename EncodeFn>
+        void WriteNumberArray(const T* values, size_t size, size_t maxLength, EncodeFn encode) {
+            WriteHead(cbor::ARRAY, size);
+
+            const size_t blockSize = MAX_RESERVE / maxLength;
+            for (size_t block = 0; block < size; block += blockSize) {
+                const size_t count = size - block < blockSize ? size - block : blockSize;
+                char* const begin = myBuffer.Push(count * maxLength);
+                char* out = begin;
+                for (size_t i = block; i < block + count; ++i) {
+                    out = encode(values[i], out);
+                }
+                myBuffer.Pop(begin + count * maxLength - out);
+            }
+        }
+
+        std::shared_ptr<BinaryFormattedData> myRequestData;
+        OutputBuffer& myBuffer;
+        bool myTypedArrays;
+        std::vector<bool> myIndefinite;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_CBORWRITER_H
@@ -19,17 +19,154 @@
 #include "jsonformatteddata.h"
 #include "dispatcher.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <future>
+#include <map>
+#include <mutex>
 #include <string>
 #include <memory>
 #include <stdexcept>
+#include <unordered_map>
+#include <vector>
 
 namespace jsonrpc {
 
     class FormatHandler;
 
+    template<typename Signature> class ClientStub;
+    class ConnectionPool;
+
+    // Appends an unambiguous encoding of the values written to it to a
+    // string, the key under which Client shares calls. Integers are encoded
+    // by value whatever their Value type, as they look the same on the wire.
+    class RequestKeyWriter {
+    public:
+        explicit RequestKeyWriter(std::string& key) : myKey(key) {}
+
+        void StartArray() { myKey.push_back('['); }
+        void StartSizedArray(size_t) { StartArray(); }
+        void EndArray() { myKey.push_back(']'); }
+        void StartStruct() { myKey.push_back('{'); }
+        void StartSizedStruct(size_t) { StartStruct(); }
+        void EndStruct() { myKey.push_back('}'); }
+        void StartStructElement(const std::string& name) { AppendString('k', name.data(), name.size()); }
+        void EndStructElement() {}
+        void WriteBinary(const char* data, size_t size) { AppendString('b', data, size); }
+        void WriteNull() { myKey.push_back('n'); }
+        void Write(bool value) { myKey.push_back(value ? 't' : 'f'); }
+        void Write(double value) { Append('d', value); }
+        void Write(int32_t value) { Append('i', static_cast<int64_t>(value)); }
+        void Write(int64_t value) { Append('i', value); }
+        void Write(const std::string& value) { AppendString('s', value.data(), value.size()); }
+        void WriteRawJson(const RawJson& value) { AppendString('r', value.GetJson().data(), value.GetJson().size()); }
+
+        template<typename T>
+        void WriteArray(const T* values, size_t size) {
+            StartArray();
+            for (size_t i = 0; i < size; ++i) {
+                Write(values[i]);
+            }
+            EndArray();
+        }
+
+    private:
+        template<typename T>
+        void Append(char tag, T value) {
+            myKey.push_back(tag);
+            myKey.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void AppendString(char tag, const char* data, size_t size) {
+            Append(tag, static_cast<uint64_t>(size));
+            myKey.append(data, size);
+        }
+
+        std::string& myKey;
+    };
+
+    // Building requests and dispatching responses are thread safe, so one
+    // Client can be shared by several threads and have many calls in flight
+    // over one connection. Configure it (SetMethodIds) before sharing it.
     class Client {
     public:
+        typedef std::function<void(Response)> ResponseHandler;
+
+        // A request whose response DispatchResponse routes back to Result
+        struct AsyncRequestData {
+            int64_t Id = -1;
+            std::shared_ptr<FormattedData> Data;
+            std::future<Value> Result;
+        };
+
+        // Collects calls and notifications into one message, written with a
+        // single writer as they are added. Get one from Client::StartBatch.
+        class Batch {
+        public:
+            // Returns the id of the call, see Client::ParseBatchResponse
+            int64_t AddRequest(const std::string& methodName, const Request::Parameters& params = {}) {
+                const int64_t id = myClient.myId++;
+                myClient.WriteRequest(methodName, params, id, *myWriter);
+                ++myCount;
+                return id;
+            }
+
+            template<typename FirstType, typename... RestTypes>
+            typename std::enable_if<!std::is_same<typename std::decay<FirstType>::type, Request::Parameters>::value, int64_t>::type
+            AddRequest(const std::string& methodName, FirstType&& first, RestTypes&&... rest) {
+                Request::Parameters params;
+                params.emplace_back(std::forward<FirstType>(first));
+
+                AddParameters(params, std::forward<RestTypes>(rest)...);
+                return AddRequest(methodName, params);
+            }
+
+            void AddNotification(const std::string& methodName, const Request::Parameters& params = {}) {
+                myClient.WriteRequest(methodName, params, false, *myWriter);
+                ++myCount;
+            }
+
+            template<typename FirstType, typename... RestTypes>
+            typename std::enable_if<!std::is_same<typename std::decay<FirstType>::type, Request::Parameters>::value>::type
+            AddNotification(const std::string& methodName, FirstType&& first, RestTypes&&... rest) {
+                Request::Parameters params;
+                params.emplace_back(std::forward<FirstType>(first));
+
+                AddParameters(params, std::forward<RestTypes>(rest)...);
+                AddNotification(methodName, params);
+            }
+
+            // Calls and notifications added so far. JSON-RPC does not allow
+            // an empty batch.
+            size_t GetCount() const { return myCount; }
+
+            // Closes the batch, nothing can be added to it afterwards
+            std::shared_ptr<FormattedData> GetData() {
+                if (!myIsClosed) {
+                    myWriter->EndBatch();
+                    myIsClosed = true;
+                }
+                return myWriter->GetData();
+            }
+
+        private:
+            friend class Client;
+
+            explicit Batch(Client& client)
+                : myClient(client),
+                myWriter(client.myFormatHandler.CreateWriter()) {
+                myWriter->StartBatch();
+            }
+
+            Client& myClient;
+            std::unique_ptr<Writer> myWriter;
+            size_t myCount = 0;
+            bool myIsClosed = false;
+        };
+
         Client(FormatHandler& formatHandler) : myFormatHandler(formatHandler), myId(0) {
 
         }
@@ -66,12 +203,383 @@ namespace jsonrpc {
             return ParseResponseInternal(aResponseData);
         }
 
+        Batch StartBatch() {
+            return Batch(*this);
+        }
+
+        // The responses to a batch sorted by id, which is the order the calls
+        // were added in. Faults are left in the responses rather than thrown,
+        // so one failed call does not hide the results of the others; a
+        // server that rejected the whole batch answers with a single fault
+        // with a null id. Notifications get no response.
+        std::vector<Response> ParseBatchResponse(const std::string& aResponseData) {
+            auto reader = myFormatHandler.CreateReader(aResponseData);
+            std::vector<Response> responses = reader->GetBatchResponse();
+            reader.reset();
+
+            std::stable_sort(responses.begin(), responses.end(), [](const Response& a, const Response& b) {
+                return HasIntegerId(a)
+                    && (!HasIntegerId(b) || a.GetId().AsInteger64() < b.GetId().AsInteger64());
+            });
+            return responses;
+        }
+
+        // The request is remembered as pending until its response is passed
+        // to DispatchResponse, which sets the future's value, or its
+        // exception to the Fault in the response
+        //
+        // For methods marked with SetIdempotent, Data is null when there is
+        // nothing to send: the result comes from an identical call already
+        // in flight, or from the cache.
+        AsyncRequestData BuildAsyncRequestData(const std::string& methodName, const Request::Parameters& params = {}) {
+            auto idempotent = myIdempotentMethods.find(methodName);
+            if (idempotent != myIdempotentMethods.end()) {
+                return BuildSharedRequestData(methodName, params, idempotent->second);
+            }
+
+            auto promise = std::make_shared<std::promise<Value>>();
+            AsyncRequestData request;
+            request.Result = promise->get_future();
+            request.Data = BuildAsyncRequestDataInternal(methodName, params, [promise](Response response) {
+                try {
+                    response.ThrowIfFault();
+                    promise->set_value(std::move(response.GetResult()));
+                }
+                catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            }, request.Id);
+            return request;
+        }
+
+        template<typename FirstType, typename... RestTypes>
+        typename std::enable_if<!std::is_same<typename std::decay<FirstType>::type, Request::Parameters>::value, AsyncRequestData>::type
+        BuildAsyncRequestData(const std::string& methodName, FirstType&& first, RestTypes&&... rest) {
+            Request::Parameters params;
+            params.emplace_back(std::forward<FirstType>(first));
+
+            AddParameters(params, std::forward<RestTypes>(rest)...);
+            return BuildAsyncRequestData(methodName, params);
+        }
+
+        // As above, with the handler called with the response, fault or not,
+        // on the thread that dispatches it
+        std::shared_ptr<FormattedData> BuildAsyncRequestData(const std::string& methodName, const Request::Parameters& params, ResponseHandler handler) {
+            int64_t id;
+            return BuildAsyncRequestDataInternal(methodName, params, std::move(handler), id);
+        }
+
+        // Completes the pending call the response belongs to, matched by id
+        // so responses may arrive in any order. Returns false when there is
+        // none, as for the null id of a request the server could not parse.
+        bool DispatchResponse(const std::string& aResponseData) {
+            auto reader = myFormatHandler.CreateReader(aResponseData);
+            Response response = reader->GetResponse();
+            reader.reset();
+            return DispatchResponse(std::move(response));
+        }
+
+        bool DispatchResponse(Response response) {
+            const Value& id = response.GetId();
+            if (!id.IsInteger32() && !id.IsInteger64()) {
+                return false;
+            }
+
+            ResponseHandler handler;
+            if (!TakePendingCall(id.AsInteger64(), handler)) {
+                return false;
+            }
+            handler(std::move(response));
+            return true;
+        }
+
+        // Forgets a pending call, its future fails with broken_promise and
+        // its handler is never called
+        bool CancelRequest(int64_t id) {
+            ResponseHandler handler;
+            return TakePendingCall(id, handler);
+        }
+
+        // Completes every pending call with a fault, for when the connection
+        // they were sent over is gone. Returns how many there were.
+        size_t FailPendingRequests(int32_t faultCode, const std::string& faultString) {
+            size_t count = 0;
+            for (auto& shard : myPendingCalls) {
+                std::unordered_map<int64_t, ResponseHandler> calls;
+                {
+                    std::lock_guard<std::mutex> lock(shard.Mutex);
+                    calls.swap(shard.Calls);
+                }
+                for (auto& call : calls) {
+                    call.second(Response(faultCode, faultString, call.first));
+                }
+                count += calls.size();
+            }
+            return count;
+        }
+
+        size_t GetPendingCount() const {
+            size_t count = 0;
+            for (auto& shard : myPendingCalls) {
+                std::lock_guard<std::mutex> lock(shard.Mutex);
+                count += shard.Calls.size();
+            }
+            return count;
+        }
+
+        // Takes the result of the server's rpc.methodIds method (see
+        // Dispatcher::EnableMethodIds) and from then on sends the id of each
+        // method listed there in place of its name. Only use this with
+        // servers that returned the ids, plain JSON-RPC 2.0 servers expect
+        // a string.
+        void SetMethodIds(const Value& methodIds) {
+            myMethodIds.clear();
+            for (auto& method : methodIds.AsStruct()) {
+                myMethodIds.emplace(method.first, method.second.AsInteger32());
+            }
+        }
+
+        void ClearMethodIds() {
+            myMethodIds.clear();
+        }
+
+        // Marks methodName as safe to call once for many identical calls.
+        // BuildAsyncRequestData then coalesces calls with the same parameters
+        // made while one is in flight into that one request, and with a
+        // non-zero cacheTtl keeps successful results that long to answer
+        // later calls from. Faults are shared but never cached.
+        Client& SetIdempotent(const std::string& methodName,
+            std::chrono::steady_clock::duration cacheTtl = std::chrono::steady_clock::duration::zero()) {
+            myIdempotentMethods[methodName] = cacheTtl;
+            return *this;
+        }
+
+        // Drops the cached results, calls in flight are not affected
+        void ClearResponseCache() {
+            std::lock_guard<std::mutex> lock(mySharedCallsMutex);
+            for (auto call = mySharedCalls.begin(); call != mySharedCalls.end();) {
+                if (call->second.Waiters.empty()) {
+                    call = mySharedCalls.erase(call);
+                } else {
+                    ++call;
+                }
+            }
+        }
+
+        // A typed stub for methodName, e.g. Stub<int(int, int)>("add"), see
+        // ClientStub. Its method id, if any, is looked up here once.
+        template<typename Signature>
+        ClientStub<Signature> Stub(std::string methodName) {
+            return ClientStub<Signature>(*this, std::move(methodName));
+        }
+
         Client(const Client&) = delete;
         Client& operator=(const Client&) = delete;
         Client(Client&&) = delete;
         Client& operator=(Client&&) = delete;
 
     private:
+        template<typename Signature> friend class ClientStub;
+        friend class ConnectionPool;
+
+        // Consecutive ids spread evenly over the shards
+        static const size_t PENDING_CALL_SHARDS = 16;
+
+        struct PendingCallShard {
+            std::mutex Mutex;
+            std::unordered_map<int64_t, ResponseHandler> Calls;
+        };
+
+        static void AddParameters(Request::Parameters&) {
+            // Empty
+        }
+
+        template<typename FirstType, typename... RestTypes>
+        static void AddParameters(Request::Parameters& params, FirstType&& first, RestTypes&&... rest) {
+            params.emplace_back(std::forward<FirstType>(first));
+            AddParameters(params, std::forward<RestTypes>(rest)...);
+        }
+
+        // An idempotent call in flight, with the promises of everyone waiting
+        // for it, or a cached result
+        struct SharedCall {
+            std::vector<std::promise<Value>> Waiters;
+            Value Result;
+            std::chrono::steady_clock::time_point Expires;
+        };
+
+        // Abandons the shared call if the pending call that would have
+        // completed it is dropped by CancelRequest
+        struct SharedCallGuard {
+            SharedCallGuard(Client& client, std::string key) : Owner(client), Key(std::move(key)) {}
+
+            ~SharedCallGuard() {
+                if (!IsCompleted) {
+                    Owner.CompleteSharedCall(Key, nullptr, std::chrono::steady_clock::duration::zero());
+                }
+            }
+
+            Client& Owner;
+            std::string Key;
+            bool IsCompleted = false;
+        };
+
+        AsyncRequestData BuildSharedRequestData(const std::string& methodName, const Request::Parameters& params,
+            std::chrono::steady_clock::duration cacheTtl) {
+            std::string key = methodName;
+            key.push_back('\0');
+            RequestKeyWriter keyWriter(key);
+            for (auto& param : params) {
+                param.Write(keyWriter);
+            }
+
+            std::promise<Value> promise;
+            AsyncRequestData request;
+            request.Result = promise.get_future();
+            {
+                std::lock_guard<std::mutex> lock(mySharedCallsMutex);
+                const auto now = std::chrono::steady_clock::now();
+                auto call = mySharedCalls.find(key);
+                if (call != mySharedCalls.end()) {
+                    if (!call->second.Waiters.empty()) {
+                        call->second.Waiters.emplace_back(std::move(promise));
+                        return request;
+                    }
+                    if (now < call->second.Expires) {
+                        promise.set_value(Value(call->second.Result));
+                        return request;
+                    }
+                } else {
+                    SweepSharedCalls(now);
+                    call = mySharedCalls.emplace(key, SharedCall()).first;
+                }
+                call->second.Waiters.emplace_back(std::move(promise));
+            }
+
+            auto guard = std::make_shared<SharedCallGuard>(*this, key);
+            try {
+                request.Data = BuildAsyncRequestDataInternal(methodName, params, [guard, cacheTtl](Response response) {
+                    guard->IsCompleted = true;
+                    guard->Owner.CompleteSharedCall(guard->Key, &response, cacheTtl);
+                }, request.Id);
+            }
+            catch (...) {
+                guard->IsCompleted = true;
+                CompleteSharedCall(key, nullptr, std::chrono::steady_clock::duration::zero(), std::current_exception());
+                throw;
+            }
+            return request;
+        }
+
+        // Hands the response, or the failure, to everyone waiting for the
+        // call; without either their futures fail with broken_promise
+        void CompleteSharedCall(const std::string& key, Response* response,
+            std::chrono::steady_clock::duration cacheTtl, std::exception_ptr failure = nullptr) {
+            if (response != nullptr) {
+                try {
+                    response->ThrowIfFault();
+                }
+                catch (...) {
+                    failure = std::current_exception();
+                }
+            }
+
+            std::vector<std::promise<Value>> waiters;
+            {
+                std::lock_guard<std::mutex> lock(mySharedCallsMutex);
+                auto call = mySharedCalls.find(key);
+                if (call == mySharedCalls.end()) {
+                    return;
+                }
+                waiters.swap(call->second.Waiters);
+                if (response != nullptr && !failure && cacheTtl > std::chrono::steady_clock::duration::zero()) {
+                    call->second.Result = Value(response->GetResult());
+                    call->second.Expires = std::chrono::steady_clock::now() + cacheTtl;
+                } else {
+                    mySharedCalls.erase(call);
+                }
+            }
+
+            if (response == nullptr && !failure) {
+                return;
+            }
+            for (size_t i = 0; i < waiters.size(); ++i) {
+                if (failure) {
+                    waiters[i].set_exception(failure);
+                } else if (i + 1 == waiters.size()) {
+                    waiters[i].set_value(std::move(response->GetResult()));
+                } else {
+                    waiters[i].set_value(Value(response->GetResult()));
+                }
+            }
+        }
+
+        // Drops expired results once the table has doubled since the last
+        // sweep, keeping the cost per call constant. Called with
+        // mySharedCallsMutex held.
+        void SweepSharedCalls(std::chrono::steady_clock::time_point now) {
+            if (mySharedCalls.size() < mySharedCallsSweepSize) {
+                return;
+            }
+            for (auto call = mySharedCalls.begin(); call != mySharedCalls.end();) {
+                if (call->second.Waiters.empty() && !(now < call->second.Expires)) {
+                    call = mySharedCalls.erase(call);
+                } else {
+                    ++call;
+                }
+            }
+            mySharedCallsSweepSize = std::max<size_t>(64, mySharedCalls.size() * 2);
+        }
+
+        static bool HasIntegerId(const Response& response) {
+            return response.GetId().IsInteger32() || response.GetId().IsInteger64();
+        }
+
+        template<typename WriterType>
+        void WriteRequest(const std::string& methodName, const Request::Parameters& params, const Value& id, WriterType& writer) {
+            auto methodId = myMethodIds.find(methodName);
+            if (methodId != myMethodIds.end()) {
+                Request::Write(methodId->second, params, id, writer);
+            } else {
+                Request::Write(methodName, params, id, writer);
+            }
+        }
+
+        PendingCallShard& GetShard(int64_t id) const {
+            return myPendingCalls[static_cast<uint64_t>(id) % PENDING_CALL_SHARDS];
+        }
+
+        std::shared_ptr<FormattedData> BuildAsyncRequestDataInternal(const std::string& methodName,
+            const Request::Parameters& params, ResponseHandler handler, int64_t& id) {
+            id = myId++;
+            auto data = FormatRequest(methodName, params, id);
+
+            auto& shard = GetShard(id);
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            shard.Calls.emplace(id, std::move(handler));
+            return data;
+        }
+
+        bool TakePendingCall(int64_t id, ResponseHandler& handler) {
+            auto& shard = GetShard(id);
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            auto call = shard.Calls.find(id);
+            if (call == shard.Calls.end()) {
+                return false;
+            }
+            handler = std::move(call->second);
+            shard.Calls.erase(call);
+            return true;
+        }
+
+        std::shared_ptr<FormattedData> FormatRequest(const std::string& methodName, const Request::Parameters& params, const Value& id) {
+            auto methodId = myMethodIds.find(methodName);
+            if (methodId != myMethodIds.end()) {
+                return myFormatHandler.FormatRequest(methodId->second, params, id);
+            }
+            return myFormatHandler.FormatRequest(methodName, params, id);
+        }
+
         template<typename FirstType, typename... RestTypes>
         std::shared_ptr<FormattedData> BuildRequestDataInternal(const std::string& methodName, Request::Parameters& params, FirstType&& first, RestTypes&&... rest) {
             params.emplace_back(std::forward<FirstType>(first));
@@ -79,10 +587,8 @@ namespace jsonrpc {
         }
 
         std::shared_ptr<FormattedData> BuildRequestDataInternal(const std::string& methodName, const Request::Parameters& params) {
-            auto writer = myFormatHandler.CreateWriter();
-            const auto id = myId++;
-            Request::Write(methodName, params, id, *writer);
-            return writer->GetData();
+            const int64_t id = myId++;
+            return FormatRequest(methodName, params, id);
         }
 
         template<typename FirstType, typename... RestTypes>
@@ -92,9 +598,7 @@ namespace jsonrpc {
         }
 
         std::shared_ptr<FormattedData> BuildNotificationDataInternal(const std::string& methodName, const Request::Parameters& params) {
-            auto writer = myFormatHandler.CreateWriter();
-            Request::Write(methodName, params, false, *writer);
-            return writer->GetData();
+            return FormatRequest(methodName, params, false);
         }
 
         Response ParseResponseInternal(const std::string& aResponseData) {
@@ -105,7 +609,158 @@ namespace jsonrpc {
         }
 
         FormatHandler& myFormatHandler;
-        int32_t myId;
+        std::atomic<int64_t> myId;
+        std::map<std::string, int32_t> myMethodIds;
+        std::map<std::string, std::chrono::steady_clock::duration> myIdempotentMethods;
+        std::mutex mySharedCallsMutex;
+        std::unordered_map<std::string, SharedCall> mySharedCalls;
+        size_t mySharedCallsSweepSize = 64;
+        // After the shared calls, which its handlers may abandon on destruction
+        mutable std::array<PendingCallShard, PENDING_CALL_SHARDS> myPendingCalls;
+    };
+
+    // Calls one method with the parameter and result types of its signature.
+    // The arguments are written straight to the format's Writer instead of
+    // being turned into a Request::Parameters of Values first, and the
+    // result is converted to ReturnType, so no per call Values or
+    // containers are built on the way out. Results still come through the
+    // reader's Response.
+    //
+    // Parameter and return types are those Value::AsType supports, plus
+    // Value itself; other parameter types are written through a Value.
+    template<typename ReturnType, typename... ParameterTypes>
+    class ClientStub < ReturnType(ParameterTypes...) > {
+    public:
+        ClientStub(Client& client, std::string methodName)
+            : myClient(client),
+            myMethodName(std::move(methodName)) {
+            auto methodId = client.myMethodIds.find(myMethodName);
+            if (methodId != client.myMethodIds.end()) {
+                myMethodId = methodId->second;
+            }
+        }
+
+        const std::string& GetMethodName() const { return myMethodName; }
+
+        std::shared_ptr<FormattedData> BuildRequestData(const ParameterTypes&... params) {
+            return Write(myClient.myId++, params...);
+        }
+
+        std::shared_ptr<FormattedData> BuildNotificationData(const ParameterTypes&... params) {
+            return Write(false, params...);
+        }
+
+        // Throws the Fault of a fault response
+        ReturnType ParseResponse(const std::string& aResponseData) {
+            auto reader = myClient.myFormatHandler.CreateReader(aResponseData);
+            Response response = reader->GetResponse();
+            reader.reset();
+            response.ThrowIfFault();
+            return GetResult<ReturnType>(response.GetResult());
+        }
+
+    private:
+        std::shared_ptr<FormattedData> Write(const Value& id, const ParameterTypes&... params) {
+            auto writer = myClient.myFormatHandler.CreateWriter();
+            writer->StartDocument();
+            if (myMethodId >= 0) {
+                writer->StartRequestById(myMethodId, id);
+            } else {
+                writer->StartRequest(myMethodName, id);
+            }
+            // Expands to one WriteParameter call per parameter, in order
+            int expand[] = { 0, (WriteParameter(*writer, params), 0)... };
+            (void)expand;
+            writer->EndRequest();
+            writer->EndDocument();
+            return writer->GetData();
+        }
+
+        static void WriteParameter(Writer& writer, bool value) {
+            writer.StartParameter();
+            writer.Write(value);
+            writer.EndParameter();
+        }
+
+        static void WriteParameter(Writer& writer, double value) {
+            writer.StartParameter();
+            writer.Write(value);
+            writer.EndParameter();
+        }
+
+        static void WriteParameter(Writer& writer, int32_t value) {
+            writer.StartParameter();
+            writer.Write(value);
+            writer.EndParameter();
+        }
+
+        static void WriteParameter(Writer& writer, int64_t value) {
+            writer.StartParameter();
+            writer.Write(value);
+            writer.EndParameter();
+        }
+
+        static void WriteParameter(Writer& writer, const char* value) {
+            writer.StartParameter();
+            writer.Write(std::string(value));
+            writer.EndParameter();
+        }
+
+        static void WriteParameter(Writer& writer, const std::string& value) {
+            writer.StartParameter();
+            writer.Write(value);
+            writer.EndParameter();
+        }
+
+        static void WriteParameter(Writer& writer, const Value::Integer32Array& value) {
+            writer.StartParameter();
+            writer.WriteArray(value.data(), value.size());
+            writer.EndParameter();
+        }
+
+        static void WriteParameter(Writer& writer, const Value::Integer64Array& value) {
+            writer.StartParameter();
+            writer.WriteArray(value.data(), value.size());
+            writer.EndParameter();
+        }
+
+        static void WriteParameter(Writer& writer, const Value::DoubleArray& value) {
+            writer.StartParameter();
+            writer.WriteArray(value.data(), value.size());
+            writer.EndParameter();
+        }
+
+        static void WriteParameter(Writer& writer, const Value& value) {
+            writer.StartParameter();
+            value.Write(writer);
+            writer.EndParameter();
+        }
+
+        template<typename T>
+        static typename std::enable_if<!std::is_arithmetic<T>::value>::type
+        WriteParameter(Writer& writer, const T& value) {
+            WriteParameter(writer, Value(value));
+        }
+
+        template<typename T>
+        static typename std::enable_if<std::is_same<T, void>::value>::type GetResult(Value&) {
+            // Empty
+        }
+
+        template<typename T>
+        static typename std::enable_if<std::is_same<T, Value>::value, Value>::type GetResult(Value& result) {
+            return std::move(result);
+        }
+
+        template<typename T>
+        static typename std::enable_if<!std::is_same<T, void>::value && !std::is_same<T, Value>::value, T>::type
+        GetResult(Value& result) {
+            return result.AsType<typename std::decay<T>::type>();
+        }
+
+        Client& myClient;
+        std::string myMethodName;
+        int32_t myMethodId = -1;
     };
 
 } // namespace jsonrpc
@@ -0,0 +1,280 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_CONNECTIONPOOL_H
+#define JSONRPC_LEAN_CONNECTIONPOOL_H
+
+#include "client.h"
+#include "fault.h"
+#include "formatteddata.h"
+#include "request.h"
+#include "response.h"
+#include "server.h"
+#include "value.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+namespace jsonrpc {
+
+    // The sending half of a connection to a server. Responses read from it
+    // are handed to ConnectionPool::DispatchResponse by whoever reads them.
+    class Connection {
+    public:
+        virtual ~Connection() {}
+
+        // Called from any thread making calls, throws if the data cannot be
+        // sent
+        virtual void Send(const std::shared_ptr<FormattedData>& data) = 0;
+    };
+
+    // Spreads the calls of a Client over several connections, to one or
+    // more servers, and keeps count of the calls outstanding on each. A
+    // connection whose server is slow collects outstanding calls and is
+    // picked less, instead of holding up the calls behind its own.
+    class ConnectionPool {
+    public:
+        enum class Balancing {
+            // The connection with the fewest outstanding calls
+            LEAST_OUTSTANDING,
+            // The less busy of two connections picked at random, close to
+            // LEAST_OUTSTANDING without looking at every connection
+            POWER_OF_TWO_CHOICES
+        };
+
+        explicit ConnectionPool(Client& client, Balancing balancing = Balancing::LEAST_OUTSTANDING)
+            : myClient(client), myBalancing(balancing), myNextConnection(0) {}
+
+        // Connections are added before the pool is shared between threads.
+        // Returns the connection's index.
+        size_t AddConnection(Connection& connection) {
+            myConnections.emplace_back(connection);
+            return myConnections.size() - 1;
+        }
+
+        // Sends the call over the chosen connection and returns the future
+        // of its result, see Client::BuildAsyncRequestData
+        std::future<Value> Call(const std::string& methodName, const Request::Parameters& params = {}) {
+            auto& connection = ChooseConnection();
+            auto outstanding = std::make_shared<OutstandingCall>(connection);
+            auto promise = std::make_shared<std::promise<Value>>();
+            auto result = promise->get_future();
+
+            int64_t id;
+            auto data = myClient.BuildAsyncRequestDataInternal(methodName, params, [promise, outstanding](Response response) {
+                try {
+                    response.ThrowIfFault();
+                    promise->set_value(std::move(response.GetResult()));
+                }
+                catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            }, id);
+            // Before the handler can go away, which takes the id back out
+            outstanding->SetId(id);
+            outstanding.reset();
+
+            try {
+                connection.Target.Send(data);
+            }
+            catch (...) {
+                myClient.CancelRequest(id);
+                throw;
+            }
+            return result;
+        }
+
+        template<typename FirstType, typename... RestTypes>
+        typename std::enable_if<!std::is_same<typename std::decay<FirstType>::type, Request::Parameters>::value, std::future<Value>>::type
+        Call(const std::string& methodName, FirstType&& first, RestTypes&&... rest) {
+            Request::Parameters params;
+            AddParameters(params, std::forward<FirstType>(first), std::forward<RestTypes>(rest)...);
+            return Call(methodName, params);
+        }
+
+        // Notifications are not outstanding, they only go to the connection
+        // the next call would
+        void Notify(const std::string& methodName, const Request::Parameters& params = {}) {
+            ChooseConnection().Target.Send(myClient.BuildNotificationData(methodName, params));
+        }
+
+        template<typename FirstType, typename... RestTypes>
+        typename std::enable_if<!std::is_same<typename std::decay<FirstType>::type, Request::Parameters>::value>::type
+        Notify(const std::string& methodName, FirstType&& first, RestTypes&&... rest) {
+            Request::Parameters params;
+            AddParameters(params, std::forward<FirstType>(first), std::forward<RestTypes>(rest)...);
+            Notify(methodName, params);
+        }
+
+        // Completes the call the response belongs to, whichever connection
+        // it came from
+        bool DispatchResponse(const std::string& aResponseData) {
+            return myClient.DispatchResponse(aResponseData);
+        }
+
+        // Completes the calls outstanding on the connection with a fault, for
+        // when it is gone. Calls sent over the other connections are left
+        // alone. Returns how many there were.
+        size_t FailConnection(size_t connection, int32_t faultCode, const std::string& faultString) {
+            std::vector<int64_t> ids;
+            {
+                auto& pooled = myConnections[connection];
+                std::lock_guard<std::mutex> lock(pooled.Mutex);
+                ids.assign(pooled.Ids.begin(), pooled.Ids.end());
+            }
+
+            size_t count = 0;
+            for (auto id : ids) {
+                Client::ResponseHandler handler;
+                if (myClient.TakePendingCall(id, handler)) {
+                    handler(Response(faultCode, faultString, id));
+                    ++count;
+                }
+            }
+            return count;
+        }
+
+        size_t GetConnectionCount() const { return myConnections.size(); }
+
+        // Calls sent over the connection not yet answered, cancelled or
+        // failed
+        size_t GetOutstandingCount(size_t connection) const {
+            return myConnections[connection].Outstanding.load(std::memory_order_relaxed);
+        }
+
+        ConnectionPool(const ConnectionPool&) = delete;
+        ConnectionPool& operator=(const ConnectionPool&) = delete;
+        ConnectionPool(ConnectionPool&&) = delete;
+        ConnectionPool& operator=(ConnectionPool&&) = delete;
+
+    private:
+        struct PooledConnection {
+            explicit PooledConnection(Connection& target) : Target(target), Outstanding(0) {}
+
+            Connection& Target;
+            std::atomic<size_t> Outstanding;
+            // The ids of the outstanding calls, see FailConnection
+            std::mutex Mutex;
+            std::unordered_set<int64_t> Ids;
+        };
+
+        // Counts a call as outstanding for as long as the client keeps its
+        // response handler, which covers completed, cancelled and failed
+        // calls alike
+        struct OutstandingCall {
+            explicit OutstandingCall(PooledConnection& connection) : Pooled(connection) {
+                Pooled.Outstanding.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            ~OutstandingCall() {
+                if (HasId) {
+                    std::lock_guard<std::mutex> lock(Pooled.Mutex);
+                    Pooled.Ids.erase(Id);
+                }
+                Pooled.Outstanding.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            void SetId(int64_t id) {
+                std::lock_guard<std::mutex> lock(Pooled.Mutex);
+                Pooled.Ids.insert(id);
+                Id = id;
+                HasId = true;
+            }
+
+            PooledConnection& Pooled;
+            int64_t Id = 0;
+            bool HasId = false;
+        };
+
+        PooledConnection& ChooseConnection() {
+            const size_t count = myConnections.size();
+            if (count == 0) {
+                throw InternalErrorFault("The connection pool has no connections");
+            }
+            if (count == 1) {
+                return myConnections[0];
+            }
+
+            if (myBalancing == Balancing::POWER_OF_TWO_CHOICES) {
+                thread_local std::minstd_rand random(
+                    static_cast<std::minstd_rand::result_type>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+                const size_t first = random() % count;
+                const size_t second = (first + 1 + random() % (count - 1)) % count;
+                auto& a = myConnections[first];
+                auto& b = myConnections[second];
+                return b.Outstanding.load(std::memory_order_relaxed) < a.Outstanding.load(std::memory_order_relaxed) ? b : a;
+            }
+
+            // Start where the last choice left off so that ties, such as
+            // when nothing is outstanding, go round all the connections
+            const size_t start = myNextConnection.fetch_add(1, std::memory_order_relaxed) % count;
+            size_t best = start;
+            size_t bestOutstanding = std::numeric_limits<size_t>::max();
+            for (size_t i = 0; i < count; ++i) {
+                const size_t index = (start + i) % count;
+                const size_t outstanding = myConnections[index].Outstanding.load(std::memory_order_relaxed);
+                if (outstanding < bestOutstanding) {
+                    best = index;
+                    bestOutstanding = outstanding;
+                    if (outstanding == 0) {
+                        break;
+                    }
+                }
+            }
+            return myConnections[best];
+        }
+
+        static void AddParameters(Request::Parameters&) {
+            // Empty
+        }
+
+        template<typename FirstType, typename... RestTypes>
+        static void AddParameters(Request::Parameters& params, FirstType&& first, RestTypes&&... rest) {
+            params.emplace_back(std::forward<FirstType>(first));
+            AddParameters(params, std::forward<RestTypes>(rest)...);
+        }
+
+        Client& myClient;
+        const Balancing myBalancing;
+        std::atomic<size_t> myNextConnection;
+        // A deque, as connections never move once added
+        std::deque<PooledConnection> myConnections;
+    };
+
+    // A connection to a Server in the same process, for tests and for
+    // trying out balancing without sockets. Each call is handled during
+    // Send and its response dispatched to the pool before Send returns.
+    class LoopbackConnection : public Connection {
+    public:
+        LoopbackConnection(Server& server, ConnectionPool& pool, std::string contentType = "application/json")
+            : myServer(server), myPool(pool), myContentType(std::move(contentType)) {}
+
+        void Send(const std::shared_ptr<FormattedData>& data) override {
+            auto response = myServer.HandleRequest(std::string(data->GetData(), data->GetSize()), myContentType);
+            if (response && response->GetSize() > 0) {
+                myPool.DispatchResponse(std::string(response->GetData(), response->GetSize()));
+            }
+        }
+
+    private:
+        Server& myServer;
+        ConnectionPool& myPool;
+        std::string myContentType;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_CONNECTIONPOOL_H
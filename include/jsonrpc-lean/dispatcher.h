@@ -21,11 +21,15 @@
 //#endif
 
 #include <functional>
+#include <string>
 #include <utility>
 #include <vector>
 
 namespace jsonrpc {
 
+    // Hidden method publishing the method ids, see Dispatcher::EnableMethodIds
+    const char METHOD_IDS_METHOD_NAME[] = "rpc.methodIds";
+
     class MethodWrapper {
     public:
         typedef std::function<Value(const Request::Parameters&)> Method;
@@ -45,6 +49,9 @@ namespace jsonrpc {
 
         const std::string& GetHelpText() const { return myHelpText; }
 
+        // Dense index assigned by the Dispatcher the method was added to
+        int32_t GetMethodId() const { return myMethodId; }
+
         template<typename... ParameterTypes>
         MethodWrapper& AddSignature(Value::Type returnType, ParameterTypes... parameterTypes) {
             mySignatures.emplace_back(std::initializer_list < Value::Type > {returnType, parameterTypes...});
@@ -59,7 +66,10 @@ namespace jsonrpc {
         }
 
     private:
+        friend class Dispatcher;
+
         Method myMethod;
+        int32_t myMethodId = -1;
         bool myIsHidden = false;
         std::string myHelpText;
         std::vector<std::vector<Value::Type>> mySignatures;
@@ -123,6 +133,8 @@ namespace jsonrpc {
             if (!result.second) {
                 throw std::invalid_argument(name + ": method already added");
             }
+            result.first->second.myMethodId = static_cast<int32_t>(myMethodsById.size());
+            myMethodsById.push_back(&result.first->second);
             return result.first->second;
         }
 
@@ -162,17 +174,72 @@ namespace jsonrpc {
             return AddMethodInternal(std::move(name), std::move(function));
         }
 
+        // Ids are never reused, a client holding the id of a removed method
+        // gets "Method not found" rather than some other method
         void RemoveMethod(const std::string& name) {
-            myMethods.erase(name);
+            auto method = myMethods.find(name);
+            if (method != myMethods.end()) {
+                myMethodsById[method->second.myMethodId] = nullptr;
+                myMethods.erase(method);
+            }
+        }
+
+        // Registers the hidden rpc.methodIds method, which returns a struct
+        // mapping the name of every visible method to its id. Clients that
+        // pass the result to Client::SetMethodIds send that id in place of
+        // the method name, which the dispatcher looks up in a plain array.
+        // The method refers back to this Dispatcher, which must not be
+        // moved afterwards. Until this is called, requests naming their
+        // method by id get "Method not found".
+        Dispatcher& EnableMethodIds() {
+            myMethodIdsEnabled = true;
+            AddMethod(METHOD_IDS_METHOD_NAME, MethodWrapper::Method([this](const Request::Parameters&) {
+                return GetMethodIds();
+            })).SetHidden();
+            return *this;
+        }
+
+        // Hidden methods have no published id, as Invoke does not resolve
+        // them by id
+        Value GetMethodIds() const {
+            Value::Struct ids;
+            for (auto& method : myMethods) {
+                if (!method.second.IsHidden()) {
+                    ids.emplace(method.first, method.second.myMethodId);
+                }
+            }
+            return Value(std::move(ids));
         }
 
         Response Invoke(const std::string& name, const Request::Parameters& parameters, const Value& id) const {
+            auto method = myMethods.find(name);
+            if (method == myMethods.end()) {
+                MethodNotFoundFault fault("Method not found: " + name);
+                return Response(fault.GetCode(), fault.GetString(), Value(id));
+            }
+            return InvokeMethod(method->second, parameters, id);
+        }
+
+        Response Invoke(int32_t methodId, const Request::Parameters& parameters, const Value& id) const {
+            if (!myMethodIdsEnabled || methodId < 0 || static_cast<size_t>(methodId) >= myMethodsById.size()
+                || myMethodsById[methodId] == nullptr || myMethodsById[methodId]->IsHidden()) {
+                MethodNotFoundFault fault("Method not found: " + std::to_string(methodId));
+                return Response(fault.GetCode(), fault.GetString(), Value(id));
+            }
+            return InvokeMethod(*myMethodsById[methodId], parameters, id);
+        }
+
+        Response Invoke(const Request& request) const {
+            if (request.HasMethodId()) {
+                return Invoke(request.GetMethodId(), request.GetParameters(), request.GetId());
+            }
+            return Invoke(request.GetMethodName(), request.GetParameters(), request.GetId());
+        }
+
+    private:
+        static Response InvokeMethod(const MethodWrapper& method, const Request::Parameters& parameters, const Value& id) {
             try {
-                auto method = myMethods.find(name);
-                if (method == myMethods.end()) {
-                    throw MethodNotFoundFault("Method not found: " + name);
-                }
-                return{ method->second(parameters), Value(id) };
+                return{ method(parameters), Value(id) };
             }
             catch (const Fault& fault) {
                 return Response(fault.GetCode(), fault.GetString(), Value(id));
@@ -189,7 +256,6 @@ namespace jsonrpc {
             }
         }
 
-    private:
         template<typename ReturnType, typename... ParameterTypes>
         MethodWrapper& AddMethodInternal(std::string name, std::function<ReturnType(ParameterTypes...)> method) {
             return AddMethodInternal(std::move(name), std::move(method), redi::index_sequence_for < ParameterTypes... > {});
@@ -216,6 +282,9 @@ namespace jsonrpc {
         }
 
         std::map<std::string, MethodWrapper> myMethods;
+        // Indexed by method id, null where a method was removed
+        std::vector<MethodWrapper*> myMethodsById;
+        bool myMethodIdsEnabled = false;
     };
 
 } // namespace jsonrpc
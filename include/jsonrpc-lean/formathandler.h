@@ -7,13 +7,17 @@
 #ifndef JSONRPC_LEAN_FORMATHANDLER_H
 #define JSONRPC_LEAN_FORMATHANDLER_H
 
+#include "request.h"
+#include "response.h"
+#include "writer.h"
+
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace jsonrpc {
 
     class Reader;
-    class Writer;
 
     class FormatHandler {
     public:
@@ -24,6 +28,48 @@ namespace jsonrpc {
         virtual bool UsesId() = 0;
         virtual std::unique_ptr<Reader> CreateReader(const std::string& data) = 0;
         virtual std::unique_ptr<Writer> CreateWriter() = 0;
+
+        // Serialize a whole message at once. These go through CreateWriter()
+        // and the virtual Writer interface by default, handlers with a
+        // concrete writer override them so that the templated Write
+        // functions are instantiated for that writer instead.
+        virtual std::shared_ptr<FormattedData> FormatRequest(const std::string& methodName,
+            const Request::Parameters& params, const Value& id) {
+            auto writer = CreateWriter();
+            Request::Write(methodName, params, id, *writer);
+            return writer->GetData();
+        }
+
+        virtual std::shared_ptr<FormattedData> FormatRequest(int32_t methodId,
+            const Request::Parameters& params, const Value& id) {
+            auto writer = CreateWriter();
+            Request::Write(methodId, params, id, *writer);
+            return writer->GetData();
+        }
+
+        virtual std::shared_ptr<FormattedData> FormatResponse(const Response& response) {
+            auto writer = CreateWriter();
+            response.Write(*writer);
+            return writer->GetData();
+        }
+
+        virtual std::shared_ptr<FormattedData> FormatBatchResponse(const std::vector<Response>& responses) {
+            auto writer = CreateWriter();
+            WriteBatchResponse(responses, *writer);
+            return writer->GetData();
+        }
+
+    protected:
+        template<typename WriterType>
+        static void WriteBatchResponse(const std::vector<Response>& responses, WriterType& writer) {
+            writer.StartDocument();
+            writer.StartBatch();
+            for (auto& response : responses) {
+                response.Write(writer);
+            }
+            writer.EndBatch();
+            writer.EndDocument();
+        }
     };
 
 } // namespace jsonrpc
@@ -6,17 +6,47 @@
 #ifndef JSONRPC_LEAN_REQUEST_DATA_H
 #define JSONRPC_LEAN_REQUEST_DATA_H
 
+#include <cstddef>
+#include <string>
+#include <vector>
+
 namespace jsonrpc {
 
     class FormattedData {
     public:
+        // One contiguous piece of the data, laid out like an iovec
+        struct Segment {
+            const char* Data;
+            size_t Size;
+        };
+
         virtual ~FormattedData() {}
 
         // Data
         virtual const char* GetData() = 0;
         virtual size_t GetSize() = 0;
+
+        // The data as a list of segments that, concatenated, equal GetData(),
+        // for transports that can send them with writev() or sendmsg()
+        // without flattening them first
+        virtual std::vector<Segment> GetSegments() {
+            return{ Segment{ GetData(), GetSize() } };
+        }
+
+        // Hands the data over to the caller. Formats that build it in a
+        // std::string move that out without copying and are left empty, the
+        // default copies.
+        virtual std::string ReleaseString() {
+            return std::string(GetData(), GetSize());
+        }
+
+        // A std::vector can't adopt a string's storage, so this always copies
+        std::vector<char> ReleaseVector() {
+            const std::string data = ReleaseString();
+            return std::vector<char>(data.begin(), data.end());
+        }
     };
 
 } // namespace jsonrpc
 
-#endif // JSONRPC_LEAN_REQUEST_DATA_H
\ No newline at end of file
+#endif // JSONRPC_LEAN_REQUEST_DATA_H
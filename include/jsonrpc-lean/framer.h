@@ -0,0 +1,123 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_FRAMER_H
+#define JSONRPC_LEAN_FRAMER_H
+
+#include "fault.h"
+#include "formatteddata.h"
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace jsonrpc {
+
+    // Splits the bytes read from a stream connection into messages and
+    // frames the responses written back. A stream server creates one per
+    // connection, so a framer may keep state between messages.
+    class Framer {
+    public:
+        virtual ~Framer() {}
+
+        // Looks for a complete message at the start of data. Returns true
+        // and sets body and contentType when there is one. consumed is the
+        // number of bytes that can be dropped from data, which may be more
+        // than zero without a message, as with skipped blank lines. Throws a
+        // Fault for input that cannot be framed; the connection is closed.
+        virtual bool ReadMessage(const char* data, size_t size, size_t& consumed,
+            std::string& body, std::string& contentType) = 0;
+
+        // Appends the response to the last message read to out. The
+        // response to a notification is empty.
+        virtual void WriteResponse(FormattedData& response, std::string& out) = 0;
+
+        // Called instead of WriteResponse when no FormatHandler takes the
+        // content type of the last message read. Closes the connection
+        // unless overridden.
+        virtual void WriteUnsupported(std::string&) {
+            throw InvalidRequestFault();
+        }
+
+        // Called when ReadMessage returns false: appends what is to be sent
+        // before more input is read, such as an interim reply asking for the
+        // rest of a message, or an error reply when the framer is closing
+        // after input it refused to frame.
+        virtual void WritePending(std::string&) {}
+
+        // Whether the connection is to be closed once the responses written
+        // so far are sent
+        virtual bool IsClosing() const { return false; }
+    };
+
+    typedef std::function<std::unique_ptr<Framer>()> FramerFactory;
+
+    // Newline delimited JSON: one message per line, one response line per
+    // call and none for notifications. A raw newline can only be whitespace
+    // between JSON tokens, as inside strings it is escaped, so those that
+    // come with a response, as from RawJson, are turned into spaces.
+    class NdjsonFramer : public Framer {
+    public:
+        explicit NdjsonFramer(size_t maxMessageSize = 16 * 1024 * 1024,
+            std::string contentType = "application/json")
+            : myMaxMessageSize(maxMessageSize), myContentType(std::move(contentType)) {}
+
+        bool ReadMessage(const char* data, size_t size, size_t& consumed,
+            std::string& body, std::string& contentType) override {
+            consumed = 0;
+            while (consumed < size) {
+                auto end = static_cast<const char*>(std::memchr(data + consumed, '\n', size - consumed));
+                if (end == nullptr) {
+                    if (size - consumed > myMaxMessageSize) {
+                        throw InvalidRequestFault();
+                    }
+                    return false;
+                }
+
+                const char* begin = data + consumed;
+                consumed = end - data + 1;
+                if (end > begin && end[-1] == '\r') {
+                    --end;
+                }
+                if (static_cast<size_t>(end - begin) > myMaxMessageSize) {
+                    throw InvalidRequestFault();
+                }
+                if (end > begin) {
+                    body.assign(begin, end);
+                    contentType = myContentType;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void WriteResponse(FormattedData& response, std::string& out) override {
+            if (response.GetSize() > 0) {
+                const size_t start = out.size();
+                out.append(response.GetData(), response.GetSize());
+                char* c = &out[start];
+                char* end = &out[0] + out.size();
+                while ((c = static_cast<char*>(std::memchr(c, '\n', end - c))) != nullptr) {
+                    *c++ = ' ';
+                }
+                out.push_back('\n');
+            }
+        }
+
+        static FramerFactory Factory(size_t maxMessageSize = 16 * 1024 * 1024) {
+            return [maxMessageSize]() {
+                return std::unique_ptr<Framer>(new NdjsonFramer(maxMessageSize));
+            };
+        }
+
+    private:
+        size_t myMaxMessageSize;
+        std::string myContentType;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_FRAMER_H
@@ -0,0 +1,391 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_HTTPFRAMER_H
+#define JSONRPC_LEAN_HTTPFRAMER_H
+
+#include "framer.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace jsonrpc {
+
+    struct HttpFramerOptions {
+        // Requests with a larger request line and headers are answered with
+        // 431, and with a larger body with 413
+        size_t MaxHeaderSize = 8 * 1024;
+        size_t MaxBodySize = 16 * 1024 * 1024;
+        // For requests without a Content-Type header
+        std::string DefaultContentType = "application/json";
+    };
+
+    // JSON-RPC over HTTP/1.1: each POST request is a message, whatever its
+    // target, and its media type picks the FormatHandler. Connections are
+    // kept alive unless the client asks otherwise or speaks HTTP/1.0
+    // without asking for it, and requests can be pipelined.
+    //
+    // Headers are parsed in place, without copying any but the media type.
+    // Calls are answered with 200, notifications with 204 and media types
+    // no FormatHandler takes with 415. Responses always carry a
+    // Content-Length, as the whole response is at hand when it is framed.
+    // A request with Expect: 100-continue gets a 100 once its header is
+    // read, unless its body came along with it. Requests that are not POST, that have
+    // no Content-Length or that are too large get an error status and the
+    // connection is closed.
+    class HttpFramer : public Framer {
+    public:
+        explicit HttpFramer(HttpFramerOptions options = HttpFramerOptions())
+            : myOptions(std::move(options)) {}
+
+        bool ReadMessage(const char* data, size_t size, size_t& consumed,
+            std::string& body, std::string& contentType) override {
+            consumed = 0;
+            if (myHeaderSize == 0) {
+                // Empty lines before a request line are skipped
+                while (myScanned == 0 && consumed < size && (data[consumed] == '\r' || data[consumed] == '\n')) {
+                    ++consumed;
+                }
+                data += consumed;
+                size -= consumed;
+
+                const size_t headerSize = FindHeaderEnd(data, size);
+                if (headerSize == 0) {
+                    if (size > myOptions.MaxHeaderSize) {
+                        Reject(431);
+                    }
+                    return false;
+                }
+                if (headerSize > myOptions.MaxHeaderSize) {
+                    Reject(431);
+                    return false;
+                }
+                if (!ParseHeader(data, headerSize)) {
+                    return false;
+                }
+                myHeaderSize = headerSize;
+            }
+
+            if (size - myHeaderSize < myBodySize) {
+                return false;
+            }
+            myIsContinueExpected = false;
+            body.assign(data + myHeaderSize, myBodySize);
+            contentType = myContentType;
+            consumed += myHeaderSize + myBodySize;
+            myHeaderSize = 0;
+            myScanned = 0;
+            return true;
+        }
+
+        void WriteResponse(FormattedData& response, std::string& out) override {
+            const size_t size = response.GetSize();
+            if (size == 0) {
+                WriteStatus(204, out);
+                WriteConnection(out);
+                out.append("\r\n");
+                return;
+            }
+
+            WriteStatus(200, out);
+            out.append("Content-Type: ").append(myContentType).append("\r\n");
+            out.append("Content-Length: ");
+            AppendNumber(size, out);
+            out.append("\r\n");
+            WriteConnection(out);
+            out.append("\r\n");
+            out.reserve(out.size() + size);
+            for (auto& segment : response.GetSegments()) {
+                out.append(segment.Data, segment.Size);
+            }
+        }
+
+        void WriteUnsupported(std::string& out) override {
+            WriteStatus(415, out);
+            out.append("Content-Length: 0\r\n");
+            WriteConnection(out);
+            out.append("\r\n");
+        }
+
+        void WritePending(std::string& out) override {
+            if (myIsContinueExpected && myHeaderSize != 0) {
+                out.append("HTTP/1.1 100 Continue\r\n\r\n");
+                myIsContinueExpected = false;
+            }
+            if (myStatus == 0) {
+                return;
+            }
+            WriteStatus(myStatus, out);
+            if (myStatus == 405) {
+                out.append("Allow: POST\r\n");
+            }
+            out.append("Content-Length: 0\r\nConnection: close\r\n\r\n");
+        }
+
+        bool IsClosing() const override { return myIsClosing; }
+
+        static FramerFactory Factory(HttpFramerOptions options = HttpFramerOptions()) {
+            return [options]() {
+                return std::unique_ptr<Framer>(new HttpFramer(options));
+            };
+        }
+
+    private:
+        // Returns the size of the request line and headers up to and with
+        // the empty line that ends them, or 0 if they are not all in yet.
+        // Lines end with CRLF or a bare LF. Resumes where the last call
+        // stopped looking.
+        size_t FindHeaderEnd(const char* data, size_t size) {
+            while (myScanned < size) {
+                auto end = static_cast<const char*>(std::memchr(data + myScanned, '\n', size - myScanned));
+                if (end == nullptr) {
+                    myScanned = size;
+                    return 0;
+                }
+                const size_t position = end - data;
+                myScanned = position + 1;
+                if (position >= 1 && (data[position - 1] == '\n'
+                    || (position >= 2 && data[position - 1] == '\r' && data[position - 2] == '\n'))) {
+                    return myScanned;
+                }
+            }
+            return 0;
+        }
+
+        // Reads the request line and the headers the framing depends on.
+        // Returns false, with the framer closing, for requests it refuses.
+        bool ParseHeader(const char* data, size_t size) {
+            const char* end = data + size;
+            const char* line = data;
+            const char* lineEnd = NextLine(line, end);
+
+            // METHOD SP target SP HTTP-version
+            auto methodEnd = static_cast<const char*>(std::memchr(line, ' ', lineEnd - line));
+            auto targetEnd = methodEnd ? static_cast<const char*>(std::memchr(methodEnd + 1, ' ', lineEnd - methodEnd - 1)) : nullptr;
+            if (targetEnd == nullptr || methodEnd == line || targetEnd == methodEnd + 1) {
+                return Reject(400);
+            }
+            const char* version = targetEnd + 1;
+            const size_t versionSize = lineEnd - version;
+            if (IsEqual(version, versionSize, "HTTP/1.1")) {
+                myIsHttp10 = false;
+            } else if (IsEqual(version, versionSize, "HTTP/1.0")) {
+                myIsHttp10 = true;
+            } else {
+                return Reject(versionSize > 5 && std::memcmp(version, "HTTP/", 5) == 0 ? 505 : 400);
+            }
+            if (!IsEqual(line, methodEnd - line, "POST")) {
+                return Reject(405);
+            }
+
+            myIsKeepAlive = !myIsHttp10;
+            myIsContinueExpected = false;
+            myContentType = myOptions.DefaultContentType;
+            bool hasLength = false;
+            size_t length = 0;
+            for (line = SkipLineEnd(lineEnd, end); line < end; line = SkipLineEnd(lineEnd, end)) {
+                lineEnd = NextLine(line, end);
+                if (line == lineEnd) {
+                    break;
+                }
+                // Folded lines are obsolete and a name runs up to the colon
+                auto colon = static_cast<const char*>(std::memchr(line, ':', lineEnd - line));
+                if (line[0] == ' ' || line[0] == '\t' || colon == nullptr || colon == line
+                    || colon[-1] == ' ' || colon[-1] == '\t') {
+                    return Reject(400);
+                }
+                const char* value = colon + 1;
+                const char* valueEnd = lineEnd;
+                TrimSpace(value, valueEnd);
+                const size_t nameSize = colon - line;
+
+                if (IsEqualNoCase(line, nameSize, "Content-Length")) {
+                    size_t parsed;
+                    if (!ParseLength(value, valueEnd, parsed) || (hasLength && parsed != length)) {
+                        return Reject(400);
+                    }
+                    hasLength = true;
+                    length = parsed;
+                } else if (IsEqualNoCase(line, nameSize, "Content-Type")) {
+                    auto parameters = static_cast<const char*>(std::memchr(value, ';', valueEnd - value));
+                    const char* typeEnd = parameters ? parameters : valueEnd;
+                    TrimSpace(value, typeEnd);
+                    myContentType.assign(value, typeEnd);
+                    for (auto& c : myContentType) {
+                        c = ToLower(c);
+                    }
+                } else if (IsEqualNoCase(line, nameSize, "Connection")) {
+                    ReadConnection(value, valueEnd);
+                } else if (IsEqualNoCase(line, nameSize, "Expect")) {
+                    // The only expectation there is, HTTP/1.0 clients cannot
+                    // take a 100
+                    if (!IsEqualNoCase(value, valueEnd - value, "100-continue")) {
+                        return Reject(417);
+                    }
+                    myIsContinueExpected = !myIsHttp10;
+                } else if (IsEqualNoCase(line, nameSize, "Transfer-Encoding")) {
+                    // Request bodies are taken with a Content-Length only
+                    return Reject(501);
+                }
+            }
+
+            if (!hasLength) {
+                return Reject(411);
+            }
+            if (length > myOptions.MaxBodySize) {
+                return Reject(413);
+            }
+            myBodySize = length;
+            return true;
+        }
+
+        // Connection is a list of options, of which close and keep-alive
+        // matter here
+        void ReadConnection(const char* value, const char* end) {
+            while (value < end) {
+                auto comma = static_cast<const char*>(std::memchr(value, ',', end - value));
+                const char* optionEnd = comma ? comma : end;
+                const char* option = value;
+                TrimSpace(option, optionEnd);
+                if (IsEqualNoCase(option, optionEnd - option, "close")) {
+                    myIsKeepAlive = false;
+                } else if (IsEqualNoCase(option, optionEnd - option, "keep-alive")) {
+                    myIsKeepAlive = true;
+                }
+                value = comma ? comma + 1 : end;
+            }
+        }
+
+        bool Reject(int status) {
+            myStatus = status;
+            myIsClosing = true;
+            return false;
+        }
+
+        // Adds the Connection header the response needs, and closes after
+        // it if the client did not keep the connection alive
+        void WriteConnection(std::string& out) {
+            if (!myIsKeepAlive) {
+                out.append("Connection: close\r\n");
+                myIsClosing = true;
+            } else if (myIsHttp10) {
+                out.append("Connection: keep-alive\r\n");
+            }
+        }
+
+        static void WriteStatus(int status, std::string& out) {
+            out.append("HTTP/1.1 ");
+            AppendNumber(static_cast<size_t>(status), out);
+            out.push_back(' ');
+            out.append(GetReason(status));
+            out.append("\r\n");
+        }
+
+        static const char* GetReason(int status) {
+            switch (status) {
+            case 200: return "OK";
+            case 204: return "No Content";
+            case 400: return "Bad Request";
+            case 405: return "Method Not Allowed";
+            case 411: return "Length Required";
+            case 413: return "Payload Too Large";
+            case 415: return "Unsupported Media Type";
+            case 417: return "Expectation Failed";
+            case 431: return "Request Header Fields Too Large";
+            case 501: return "Not Implemented";
+            case 505: return "HTTP Version Not Supported";
+            default: return "Error";
+            }
+        }
+
+        static void AppendNumber(size_t number, std::string& out) {
+            char digits[3 * sizeof(size_t)];
+            char* first = digits + sizeof(digits);
+            do {
+                *--first = static_cast<char>('0' + number % 10);
+                number /= 10;
+            } while (number > 0);
+            out.append(first, digits + sizeof(digits));
+        }
+
+        static bool ParseLength(const char* value, const char* end, size_t& length) {
+            if (value == end) {
+                return false;
+            }
+            length = 0;
+            for (; value < end; ++value) {
+                if (*value < '0' || *value > '9' || length > (static_cast<size_t>(-1) - 9) / 10) {
+                    return false;
+                }
+                length = length * 10 + static_cast<size_t>(*value - '0');
+            }
+            return true;
+        }
+
+        // The end of the line starting at line, before its CR if any
+        static const char* NextLine(const char* line, const char* end) {
+            auto newline = static_cast<const char*>(std::memchr(line, '\n', end - line));
+            const char* lineEnd = newline ? newline : end;
+            return lineEnd > line && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+        }
+
+        static const char* SkipLineEnd(const char* lineEnd, const char* end) {
+            if (lineEnd < end && *lineEnd == '\r') {
+                ++lineEnd;
+            }
+            return lineEnd < end ? lineEnd + 1 : end;
+        }
+
+        static void TrimSpace(const char*& begin, const char*& end) {
+            while (begin < end && (*begin == ' ' || *begin == '\t')) {
+                ++begin;
+            }
+            while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) {
+                --end;
+            }
+        }
+
+        static bool IsEqual(const char* data, size_t size, const char* literal) {
+            return size == std::strlen(literal) && std::memcmp(data, literal, size) == 0;
+        }
+
+        static bool IsEqualNoCase(const char* data, size_t size, const char* literal) {
+            if (size != std::strlen(literal)) {
+                return false;
+            }
+            for (size_t i = 0; i < size; ++i) {
+                if (ToLower(data[i]) != ToLower(literal[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static char ToLower(char c) {
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        HttpFramerOptions myOptions;
+        // Bytes of the next request searched for the end of its header
+        size_t myScanned = 0;
+        // Set once the header of the next request is read, while its body
+        // comes in
+        size_t myHeaderSize = 0;
+        size_t myBodySize = 0;
+        // Of the last request read, for its response
+        std::string myContentType;
+        bool myIsHttp10 = false;
+        bool myIsKeepAlive = true;
+        // Until the 100 is sent or the body is in
+        bool myIsContinueExpected = false;
+        // A status for input refused, sent before closing
+        int myStatus = 0;
+        bool myIsClosing = false;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_HTTPFRAMER_H
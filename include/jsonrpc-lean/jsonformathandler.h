@@ -10,6 +10,8 @@
 
 #include "formathandler.h"
 #include "jsonreader.h"
+#include "jsonsaxreader.h"
+#include "jsonsizer.h"
 #include "jsonwriter.h"
 
 #include <memory>
@@ -22,6 +24,71 @@ namespace jsonrpc {
     public:
         explicit JsonFormatHandler() {}
 
+        JsonFormatHandler& SetBinaryDetection(BinaryDetection binaryDetection) {
+            myBinaryDetection = binaryDetection;
+            return *this;
+        }
+
+        BinaryDetection GetBinaryDetection() const { return myBinaryDetection; }
+
+        // Parse with JsonSaxReader instead of building a rapidjson::Document
+        JsonFormatHandler& SetSaxParsing(bool saxParsing = true) {
+            mySaxParsing = saxParsing;
+            return *this;
+        }
+
+        bool IsSaxParsing() const { return mySaxParsing; }
+
+        // Parse into a per-thread JsonParseArena preallocated with size bytes
+        // instead of growing fresh rapidjson pools for every reader, 0 (the
+        // default) turns it off
+        JsonFormatHandler& SetParseArena(size_t size) {
+            myParseArenaSize = size;
+            return *this;
+        }
+
+        size_t GetParseArena() const { return myParseArenaSize; }
+
+        // Keep object and array parameters of incoming requests as RawJson
+        // instead of converting them, for methods that only pass them on.
+        // Spans are only available from the SAX parser, so this implies
+        // SetSaxParsing().
+        JsonFormatHandler& SetRawParams(bool rawParams = true) {
+            myRawParams = rawParams;
+            return *this;
+        }
+
+        bool IsRawParams() const { return myRawParams; }
+
+        // Reference RawJson results of at least threshold bytes from the
+        // formatted data instead of copying them in, see
+        // FormattedData::GetSegments(); 0 (the default) turns it off
+        JsonFormatHandler& SetSegmentThreshold(size_t threshold) {
+            mySegmentThreshold = threshold;
+            return *this;
+        }
+
+        size_t GetSegmentThreshold() const { return mySegmentThreshold; }
+
+        // See JsonWriter::SetUtf8Validation()
+        JsonFormatHandler& SetUtf8Validation(bool utf8Validation = true) {
+            myUtf8Validation = utf8Validation;
+            return *this;
+        }
+
+        bool IsUtf8Validation() const { return myUtf8Validation; }
+
+        // Measure requests and responses with a JsonSizer before writing
+        // them, so that the output buffer is allocated once at its final
+        // size instead of growing as it fills up. Costs an extra pass over
+        // the value, see the write section of examples/benchmark.cpp.
+        JsonFormatHandler& SetExactSizing(bool exactSizing = true) {
+            myExactSizing = exactSizing;
+            return *this;
+        }
+
+        bool IsExactSizing() const { return myExactSizing; }
+
         // FormatHandler
         bool CanHandleRequest(const std::string& contentType) override {
             return contentType == APPLICATION_JSON;
@@ -36,15 +103,74 @@ namespace jsonrpc {
         }
 
         std::unique_ptr<Reader> CreateReader(const std::string& data) override {
-            return std::unique_ptr<Reader>(std::make_unique<JsonReader>(std::move(data)));
+            if (mySaxParsing || myRawParams) {
+                return std::unique_ptr<Reader>(std::make_unique<JsonSaxReader>(data, myBinaryDetection, myParseArenaSize, myRawParams));
+            }
+            return std::unique_ptr<Reader>(std::make_unique<JsonReader>(std::move(data), myBinaryDetection, myParseArenaSize));
         }
 
         std::unique_ptr<Writer> CreateWriter() override {
-            return std::unique_ptr<Writer>(std::make_unique<JsonWriter>());
+            auto writer = std::make_unique<JsonWriter>(mySegmentThreshold);
+            writer->SetUtf8Validation(myUtf8Validation);
+            return std::unique_ptr<Writer>(std::move(writer));
+        }
+
+        std::shared_ptr<FormattedData> FormatRequest(const std::string& methodName,
+            const Request::Parameters& params, const Value& id) override {
+            return FormatRequestInternal(methodName, params, id);
+        }
+
+        std::shared_ptr<FormattedData> FormatRequest(int32_t methodId,
+            const Request::Parameters& params, const Value& id) override {
+            return FormatRequestInternal(methodId, params, id);
+        }
+
+        std::shared_ptr<FormattedData> FormatResponse(const Response& response) override {
+            JsonWriter writer(mySegmentThreshold);
+            writer.SetUtf8Validation(myUtf8Validation);
+            if (myExactSizing) {
+                JsonSizer sizer(mySegmentThreshold);
+                response.Write(sizer);
+                writer.Reserve(sizer.GetSize());
+            }
+            response.Write(writer);
+            return writer.GetData();
+        }
+
+        std::shared_ptr<FormattedData> FormatBatchResponse(const std::vector<Response>& responses) override {
+            JsonWriter writer(mySegmentThreshold);
+            writer.SetUtf8Validation(myUtf8Validation);
+            if (myExactSizing) {
+                JsonSizer sizer(mySegmentThreshold);
+                WriteBatchResponse(responses, sizer);
+                writer.Reserve(sizer.GetSize());
+            }
+            WriteBatchResponse(responses, writer);
+            return writer.GetData();
         }
 
     private:
+        template<typename MethodType>
+        std::shared_ptr<FormattedData> FormatRequestInternal(const MethodType& method,
+            const Request::Parameters& params, const Value& id) {
+            JsonWriter writer(mySegmentThreshold);
+            writer.SetUtf8Validation(myUtf8Validation);
+            if (myExactSizing) {
+                JsonSizer sizer(mySegmentThreshold);
+                Request::Write(method, params, id, sizer);
+                writer.Reserve(sizer.GetSize());
+            }
+            Request::Write(method, params, id, writer);
+            return writer.GetData();
+        }
 
+        BinaryDetection myBinaryDetection = BinaryDetection::NUL_BYTE;
+        bool mySaxParsing = false;
+        size_t myParseArenaSize = 0;
+        bool myRawParams = false;
+        size_t mySegmentThreshold = 0;
+        bool myUtf8Validation = false;
+        bool myExactSizing = false;
     };
 
 } // namespace jsonrpc
@@ -7,35 +7,114 @@
 #define JSONRPC_LEAN_JSONREQUESTDATA_H
 
 #include "formatteddata.h"
+#include "outputbuffer.h"
 
 #define RAPIDJSON_NO_SIZETYPEDEFINE
 namespace rapidjson { typedef ::std::size_t SizeType; }
 
 #include <rapidjson/writer.h>
-#include <rapidjson/stringbuffer.h>
+
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace jsonrpc {
 
     class JsonFormattedData final : public FormattedData {
     public:
-        JsonFormattedData() : Writer(myStringBuffer) {
+        JsonFormattedData() : Writer(myBuffer) {
+
+        }
+
+        // Writes into buffer, reusing its capacity; e.g. a string an earlier
+        // ReleaseString() handed out that the transport is done with
+        explicit JsonFormattedData(std::string buffer) : myBuffer(std::move(buffer)), Writer(myBuffer) {
 
         }
 
         const char* GetData() override {
-            return myStringBuffer.GetString();
+            if (myBorrowed.empty()) {
+                return myBuffer.GetString();
+            }
+
+            // Flattened on demand, transports that can should use
+            // GetSegments() instead
+            if (myFlattened.empty()) {
+                myFlattened.reserve(GetSize());
+                for (auto& segment : GetSegments()) {
+                    myFlattened.append(segment.Data, segment.Size);
+                }
+            }
+            return myFlattened.data();
         }
 
         size_t GetSize() override {
-            return myStringBuffer.GetSize();
+            size_t size = myBuffer.GetSize();
+            for (auto& borrowed : myBorrowed) {
+                size += borrowed.Data->size();
+            }
+            return size;
         }
 
-        rapidjson::Writer<rapidjson::StringBuffer> Writer;
+        std::vector<Segment> GetSegments() override {
+            const char* const buffer = myBuffer.GetString();
+            std::vector<Segment> segments;
+            segments.reserve(myBorrowed.size() * 2 + 1);
+
+            size_t offset = 0;
+            for (auto& borrowed : myBorrowed) {
+                if (borrowed.Offset != offset) {
+                    segments.push_back(Segment{ buffer + offset, borrowed.Offset - offset });
+                    offset = borrowed.Offset;
+                }
+                if (!borrowed.Data->empty()) {
+                    segments.push_back(Segment{ borrowed.Data->data(), borrowed.Data->size() });
+                }
+            }
+            if (offset != myBuffer.GetSize() || segments.empty()) {
+                segments.push_back(Segment{ buffer + offset, myBuffer.GetSize() - offset });
+            }
+            return segments;
+        }
+
+        std::string ReleaseString() override {
+            std::string data;
+            if (myBorrowed.empty()) {
+                data = myBuffer.Release();
+            } else {
+                // The borrowed segments have to be copied in regardless
+                GetData();
+                data = std::move(myFlattened);
+                myFlattened.clear();
+                myBorrowed.clear();
+                myBuffer.Clear();
+            }
+            return data;
+        }
+
+        OutputBuffer& GetBuffer() {
+            return myBuffer;
+        }
+
+        // Splices data in at the current end of the buffer without copying
+        // it; the data is kept alive for as long as this object
+        void AddBorrowed(std::shared_ptr<const std::string> data) {
+            myBorrowed.push_back(Borrowed{ myBuffer.GetSize(), std::move(data) });
+        }
 
     private:
+        struct Borrowed {
+            size_t Offset;
+            std::shared_ptr<const std::string> Data;
+        };
+
+        // Constructed before the Writer that writes into it
+        OutputBuffer myBuffer;
+        std::vector<Borrowed> myBorrowed;
+        std::string myFlattened;
 
-        rapidjson::StringBuffer myStringBuffer;
-        
+    public:
+        rapidjson::Writer<OutputBuffer> Writer;
     };
 
 } // namespace jsonrpc
@@ -0,0 +1,116 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_JSONPARSEARENA_H
+#define JSONRPC_LEAN_JSONPARSEARENA_H
+
+#include <cstddef>
+
+#define RAPIDJSON_NO_SIZETYPEDEFINE
+namespace rapidjson { typedef ::std::size_t SizeType; }
+
+#include <rapidjson/allocators.h>
+#include <rapidjson/document.h>
+
+#include <memory>
+
+namespace jsonrpc {
+
+    typedef rapidjson::MemoryPoolAllocator<> JsonPoolAllocator;
+
+    // Documents whose parse stack comes from a pool as well, so that it can
+    // live in a JsonParseArena
+    typedef rapidjson::GenericDocument<rapidjson::UTF8<>, JsonPoolAllocator, JsonPoolAllocator> JsonDocument;
+
+    // Preallocated rapidjson pools shared by the readers of one thread.
+    // Parsed values come from the value pool and the parser stacks from the
+    // stack pool; both are cleared, not freed, once a reader is done, so in
+    // the steady state parsing makes no allocations at all as long as
+    // documents fit in the preallocated chunks.
+    class JsonParseArena {
+    public:
+        // Borrows the calling thread's arena for the lifetime of a reader.
+        // Readers that overlap on one thread, or that pass a size of 0, get
+        // null allocators and rapidjson falls back to allocating its own.
+        // Sizes below MIN_SIZE are rounded up to it.
+        class Lease {
+        public:
+            explicit Lease(size_t size) : myArena(size != 0 ? Acquire(size) : nullptr) {}
+
+            ~Lease() {
+                if (myArena != nullptr) {
+                    myArena->Release();
+                }
+            }
+
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+
+            JsonPoolAllocator* GetValueAllocator() const {
+                return myArena != nullptr ? &myArena->myValueAllocator : nullptr;
+            }
+
+            JsonPoolAllocator* GetStackAllocator() const {
+                return myArena != nullptr ? &myArena->myStackAllocator : nullptr;
+            }
+
+        private:
+            JsonParseArena* myArena;
+        };
+
+        JsonParseArena(const JsonParseArena&) = delete;
+        JsonParseArena& operator=(const JsonParseArena&) = delete;
+
+        // One rapidjson chunk, RAPIDJSON_ALLOCATOR_DEFAULT_CHUNK_CAPACITY
+        static const size_t MIN_SIZE = 64 * 1024;
+
+    private:
+        // While a flat array is being parsed its elements sit on the stack
+        // before they are moved into the value pool, hence the generous split
+        explicit JsonParseArena(size_t size)
+            : mySize(size),
+            myBuffer(new char[Align(size) + Align(size / 2)]),
+            myValueAllocator(myBuffer.get(), Align(size)),
+            myStackAllocator(myBuffer.get() + Align(size), Align(size / 2)) {
+        }
+
+        static size_t Align(size_t size) {
+            const size_t alignment = 16;
+            return (size + alignment - 1) & ~(alignment - 1);
+        }
+
+        // Handlers asking for different sizes on one thread share the
+        // largest arena asked for so far instead of replacing it in turn
+        static JsonParseArena* Acquire(size_t size) {
+            thread_local std::unique_ptr<JsonParseArena> arena;
+            if (arena && arena->myInUse) {
+                return nullptr;
+            }
+            if (size < MIN_SIZE) {
+                size = MIN_SIZE;
+            }
+            if (!arena || arena->mySize < size) {
+                arena.reset(new JsonParseArena(size));
+            }
+            arena->myInUse = true;
+            return arena.get();
+        }
+
+        void Release() {
+            myValueAllocator.Clear();
+            myStackAllocator.Clear();
+            myInUse = false;
+        }
+
+        size_t mySize;
+        std::unique_ptr<char[]> myBuffer;
+        JsonPoolAllocator myValueAllocator;
+        JsonPoolAllocator myStackAllocator;
+        bool myInUse = false;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_JSONPARSEARENA_H
@@ -10,6 +10,7 @@
 #include "reader.h"
 #include "fault.h"
 #include "json.h"
+#include "jsonparsearena.h"
 #include "request.h"
 #include "response.h"
 #include "util.h"
@@ -20,12 +21,50 @@ namespace rapidjson { typedef ::std::size_t SizeType; }
 
 #include <rapidjson/document.h>
 #include <string>
+#include <vector>
 
 namespace jsonrpc {
 
+    // How a reader tells BINARY strings apart from text ones. JSON has no
+    // binary type: JsonWriter writes BINARY values as base64 strings, which
+    // only BASE64 turns back into BINARY ones. The others leave them as
+    // base64 text, see Value::DecodeBinaryTo.
+    enum class BinaryDetection {
+        NONE,       // every string is a STRING, for text only deployments
+        NUL_BYTE,   // strings with an embedded '\0' are BINARY, as raw bytes
+                    // written by peers that do not use base64
+        BASE64      // non-empty padded base64 strings are decoded to BINARY,
+                    // for peers that agree to send text otherwise
+    };
+
+    // Makes a Value of a string as read, classified by binaryDetection.
+    // Base64 is decoded straight into the Value's storage.
+    inline Value ReadJsonString(const char* str, size_t size, BinaryDetection binaryDetection) {
+        switch (binaryDetection) {
+        case BinaryDetection::NUL_BYTE:
+            return Value(std::string(str, size), util::HasNulByte(str, size));
+        case BinaryDetection::BASE64:
+            if (size > 0 && util::IsBase64(str, size)) {
+                std::string data(util::Base64DecodedMaxSize(size), '\0');
+                data.resize(util::Base64DecodeTo(str, size, &data[0]));
+                return Value(std::move(data), true);
+            }
+            break;
+        case BinaryDetection::NONE:
+            break;
+        }
+        return Value(std::string(str, size));
+    }
+
     class JsonReader final : public Reader {
     public:
-        JsonReader(const std::string& data) {
+        // With a non-zero arenaSize the document is parsed into the calling
+        // thread's JsonParseArena of that size, see JsonParseArena
+        JsonReader(const std::string& data, BinaryDetection binaryDetection = BinaryDetection::NUL_BYTE,
+            size_t arenaSize = 0)
+            : myBinaryDetection(binaryDetection),
+            myArena(arenaSize),
+            myDocument(myArena.GetValueAllocator(), STACK_CAPACITY, myArena.GetStackAllocator()) {
             myDocument.Parse(data.c_str());
             if (myDocument.HasParseError()) {
                 throw ParseErrorFault(
@@ -35,20 +74,63 @@ namespace jsonrpc {
 
         // Reader
         Request GetRequest() override {
-            if (!myDocument.IsObject()) {
+            return GetRequest(myDocument);
+        }
+
+        bool IsBatch() override {
+            return myDocument.IsArray();
+        }
+
+        size_t GetBatchSize() override {
+            return myDocument.Size();
+        }
+
+        Request GetBatchRequest(size_t index) override {
+            return GetRequest(myDocument[static_cast<rapidjson::SizeType>(index)]);
+        }
+
+        Response GetResponse() override {
+            return GetResponse(myDocument);
+        }
+
+        // A single response, as sent for a batch the server could not
+        // process, comes back on its own
+        std::vector<Response> GetBatchResponse() override {
+            std::vector<Response> responses;
+            if (!myDocument.IsArray()) {
+                responses.emplace_back(GetResponse(myDocument));
+                return responses;
+            }
+
+            responses.reserve(myDocument.Size());
+            for (auto response = myDocument.Begin(); response != myDocument.End(); ++response) {
+                responses.emplace_back(GetResponse(*response));
+            }
+            return responses;
+        }
+
+        Value GetValue() override {
+            return GetValue(myDocument);
+        }
+
+    private:
+        Request GetRequest(const rapidjson::Value& object) const {
+            if (!object.IsObject()) {
                 throw InvalidRequestFault();
             }
 
-            ValidateJsonrpcVersion();
+            ValidateJsonrpcVersion(object);
 
-            auto method = myDocument.FindMember(json::METHOD_NAME);
-            if (method == myDocument.MemberEnd() || !method->value.IsString()) {
+            // A method id in place of the name, see Dispatcher::EnableMethodIds
+            auto method = object.FindMember(json::METHOD_NAME);
+            if (method == object.MemberEnd()
+                || !(method->value.IsString() || (method->value.IsInt() && method->value.GetInt() >= 0))) {
                 throw InvalidRequestFault();
             }
 
             Request::Parameters parameters;
-            auto params = myDocument.FindMember(json::PARAMS_NAME);
-            if (params != myDocument.MemberEnd()) {
+            auto params = object.FindMember(json::PARAMS_NAME);
+            if (params != object.MemberEnd()) {
                 if (!params->value.IsArray()) {
                     throw InvalidRequestFault();
                 }
@@ -59,38 +141,38 @@ namespace jsonrpc {
                 }
             }
 
-            auto id = myDocument.FindMember(json::ID_NAME);
-            if (id == myDocument.MemberEnd()) {
-                // Notification
-                return Request(method->value.GetString(), std::move(parameters), false);
-            }
+            // Notification without an id
+            auto id = object.FindMember(json::ID_NAME);
+            Value requestId = id == object.MemberEnd() ? Value(false) : GetId(id->value);
 
-            return Request(method->value.GetString(), std::move(parameters),
-                GetId(id->value));
+            if (method->value.IsInt()) {
+                return Request(method->value.GetInt(), std::move(parameters), std::move(requestId));
+            }
+            return Request(method->value.GetString(), std::move(parameters), std::move(requestId));
         }
 
-        Response GetResponse() override {
-            if (!myDocument.IsObject()) {
+        Response GetResponse(const rapidjson::Value& object) const {
+            if (!object.IsObject()) {
                 throw InvalidRequestFault();
             }
 
-            ValidateJsonrpcVersion();
+            ValidateJsonrpcVersion(object);
 
-            auto id = myDocument.FindMember(json::ID_NAME);
-            if (id == myDocument.MemberEnd()) {
+            auto id = object.FindMember(json::ID_NAME);
+            if (id == object.MemberEnd()) {
                 throw InvalidRequestFault();
             }
 
-            auto result = myDocument.FindMember(json::RESULT_NAME);
-            auto error = myDocument.FindMember(json::ERROR_NAME);
+            auto result = object.FindMember(json::RESULT_NAME);
+            auto error = object.FindMember(json::ERROR_NAME);
 
-            if (result != myDocument.MemberEnd()) {
-                if (error != myDocument.MemberEnd()) {
+            if (result != object.MemberEnd()) {
+                if (error != object.MemberEnd()) {
                     throw InvalidRequestFault();
                 }
                 return Response(GetValue(result->value), GetId(id->value));
-            } else if (error != myDocument.MemberEnd()) {
-                if (result != myDocument.MemberEnd()) {
+            } else if (error != object.MemberEnd()) {
+                if (result != object.MemberEnd()) {
                     throw InvalidRequestFault();
                 }
                 if (!error->value.IsObject()) {
@@ -112,14 +194,9 @@ namespace jsonrpc {
             }
         }
 
-        Value GetValue() override {
-            return GetValue(myDocument);
-        }
-
-    private:
-        void ValidateJsonrpcVersion() const {
-            auto jsonrpc = myDocument.FindMember(json::JSONRPC_NAME);
-            if (jsonrpc == myDocument.MemberEnd()
+        static void ValidateJsonrpcVersion(const rapidjson::Value& object) {
+            auto jsonrpc = object.FindMember(json::JSONRPC_NAME);
+            if (jsonrpc == object.MemberEnd()
                 || !jsonrpc->value.IsString()
                 || strcmp(jsonrpc->value.GetString(), json::JSONRPC_VERSION_2_0) != 0) {
                 throw InvalidRequestFault();
@@ -142,6 +219,35 @@ namespace jsonrpc {
                 return Value(std::move(data));
             }
             case rapidjson::kArrayType: {
+                switch (GetNumericArrayType(value)) {
+                case Value::Type::INTEGER_32_ARRAY: {
+                    Value::Integer32Array array;
+                    array.reserve(value.Size());
+                    for (auto it = value.Begin(); it != value.End(); ++it) {
+                        array.push_back(it->GetInt());
+                    }
+                    return Value(std::move(array));
+                }
+                case Value::Type::INTEGER_64_ARRAY: {
+                    Value::Integer64Array array;
+                    array.reserve(value.Size());
+                    for (auto it = value.Begin(); it != value.End(); ++it) {
+                        array.push_back(it->GetInt64());
+                    }
+                    return Value(std::move(array));
+                }
+                case Value::Type::DOUBLE_ARRAY: {
+                    Value::DoubleArray array;
+                    array.reserve(value.Size());
+                    for (auto it = value.Begin(); it != value.End(); ++it) {
+                        array.push_back(it->GetDouble());
+                    }
+                    return Value(std::move(array));
+                }
+                default:
+                    break;
+                }
+
                 Value::Array array;
                 array.reserve(value.Size());
                 for (auto it = value.Begin(); it != value.End(); ++it) {
@@ -150,9 +256,8 @@ namespace jsonrpc {
                 return Value(std::move(array));
             }
             case rapidjson::kStringType: {
-                std::string str(value.GetString(), value.GetStringLength());
-                const bool binary = str.find('\0') != std::string::npos;
-                return Value(std::move(str), binary);
+                // Classified on the parsed bytes, before they are copied out
+                return ReadJsonString(value.GetString(), value.GetStringLength(), myBinaryDetection);
             }
             case rapidjson::kNumberType:
                 if (value.IsDouble()) {
@@ -173,6 +278,28 @@ namespace jsonrpc {
             throw InternalErrorFault();
         }
 
+        // Non-empty arrays holding only numbers are stored contiguously, using
+        // the narrowest element type that fits all of them
+        static Value::Type GetNumericArrayType(const rapidjson::Value& value) {
+            if (value.Size() == 0) {
+                return Value::Type::ARRAY;
+            }
+
+            auto type = Value::Type::INTEGER_32_ARRAY;
+            for (auto it = value.Begin(); it != value.End(); ++it) {
+                if (!it->IsNumber()) {
+                    return Value::Type::ARRAY;
+                } else if (it->IsInt() || type == Value::Type::DOUBLE_ARRAY) {
+                    continue;
+                } else if (it->IsInt64()) {
+                    type = Value::Type::INTEGER_64_ARRAY;
+                } else {
+                    type = Value::Type::DOUBLE_ARRAY;
+                }
+            }
+            return type;
+        }
+
         Value GetId(const rapidjson::Value& id) const {
             if (id.IsString()) {
                 return id.GetString();
@@ -187,8 +314,13 @@ namespace jsonrpc {
             throw InvalidRequestFault();
         }
 
+        // rapidjson's default initial parse stack capacity
+        static const size_t STACK_CAPACITY = 1024;
+
         std::string myData;
-        rapidjson::Document myDocument;
+        BinaryDetection myBinaryDetection;
+        JsonParseArena::Lease myArena;
+        JsonDocument myDocument;
     };
 
 } // namespace jsonrpc
@@ -0,0 +1,618 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_JSONSAXREADER_H
+#define JSONRPC_LEAN_JSONSAXREADER_H
+
+#include "reader.h"
+#include "fault.h"
+#include "json.h"
+#include "jsonparsearena.h"
+#include "jsonreader.h"
+#include "request.h"
+#include "response.h"
+#include "util.h"
+#include "value.h"
+
+#define RAPIDJSON_NO_SIZETYPEDEFINE
+namespace rapidjson { typedef ::std::size_t SizeType; }
+
+#include <rapidjson/reader.h>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace jsonrpc {
+
+    // A Reader that runs rapidjson's SAX parser straight into the JSON-RPC
+    // envelope: the top level members are recognized as they stream by and
+    // the elements of "params" go directly into Request::Parameters, so no
+    // intermediate rapidjson::Document is ever built or walked.
+    //
+    // With rawParams set, parameters that are objects or arrays are not
+    // converted at all: their source text is kept as a RawJson value.
+    class JsonSaxReader final : public Reader {
+    public:
+        JsonSaxReader(const std::string& data, BinaryDetection binaryDetection = BinaryDetection::NUL_BYTE,
+            size_t arenaSize = 0, bool rawParams = false)
+            : myHandler(binaryDetection, rawParams ? &data : nullptr) {
+            // Only the parser's own stack can come from the arena here, the
+            // values are built straight away
+            JsonParseArena::Lease arena(arenaSize);
+            rapidjson::GenericReader<rapidjson::UTF8<>, rapidjson::UTF8<>, JsonPoolAllocator> reader(arena.GetStackAllocator());
+            rapidjson::StringStream stream(data.c_str());
+            myHandler.SetStream(&stream);
+            auto result = reader.Parse(stream, myHandler);
+            if (result.IsError()) {
+                throw ParseErrorFault(
+                    "Parse error: " + std::to_string(result.Code()));
+            }
+        }
+
+        // Reader
+        Request GetRequest() override {
+            if (!myHandler.IsEnvelope) {
+                throw InvalidRequestFault();
+            }
+
+            ValidateJsonrpcVersion();
+
+            if (!myHandler.HasMethod) {
+                throw InvalidRequestFault();
+            }
+
+            if (myHandler.HasParams && !myHandler.ParamsIsArray) {
+                throw InvalidRequestFault();
+            }
+
+            // Notification without an id
+            Value id = myHandler.HasId ? GetId(myHandler.Id) : Value(false);
+
+            if (myHandler.MethodId >= 0) {
+                return Request(myHandler.MethodId, std::move(myHandler.Parameters), std::move(id));
+            }
+            return Request(std::move(myHandler.Method), std::move(myHandler.Parameters), std::move(id));
+        }
+
+        bool IsBatch() override {
+            return !myHandler.IsEnvelope && myHandler.Root.IsArray();
+        }
+
+        size_t GetBatchSize() override {
+            return myHandler.Root.AsArray().size();
+        }
+
+        // Batch elements are parsed as plain structs, whose members are then
+        // moved into the request
+        Request GetBatchRequest(size_t index) override {
+            auto& element = myHandler.Root.AsArray()[index];
+            if (!element.IsStruct()) {
+                throw InvalidRequestFault();
+            }
+            auto& members = const_cast<Value::Struct&>(element.AsStruct());
+
+            ValidateJsonrpcVersion(members);
+
+            auto method = members.find(json::METHOD_NAME);
+            if (method == members.end()
+                || !(method->second.IsString() || (method->second.IsInteger32() && method->second.AsInteger32() >= 0))) {
+                throw InvalidRequestFault();
+            }
+
+            Request::Parameters parameters;
+            auto params = members.find(json::PARAMS_NAME);
+            if (params != members.end()) {
+                if (!params->second.IsArray()) {
+                    throw InvalidRequestFault();
+                }
+                for (auto& param : const_cast<Value::Array&>(params->second.AsArray())) {
+                    parameters.emplace_back(std::move(param));
+                }
+            }
+
+            // Notification without an id
+            auto id = members.find(json::ID_NAME);
+            Value requestId = id == members.end() ? Value(false) : GetId(id->second);
+
+            if (method->second.IsInteger32()) {
+                return Request(method->second.AsInteger32(), std::move(parameters), std::move(requestId));
+            }
+            return Request(method->second.AsString(), std::move(parameters), std::move(requestId));
+        }
+
+        Response GetResponse() override {
+            if (!myHandler.IsEnvelope) {
+                throw InvalidRequestFault();
+            }
+
+            ValidateJsonrpcVersion();
+
+            if (!myHandler.HasId) {
+                throw InvalidRequestFault();
+            }
+
+            return GetResponse(myHandler.HasResult ? &myHandler.Result : nullptr,
+                myHandler.HasError ? &myHandler.Error : nullptr, myHandler.Id);
+        }
+
+        // A single response, as sent for a batch the server could not
+        // process, comes back on its own
+        std::vector<Response> GetBatchResponse() override {
+            std::vector<Response> responses;
+            if (myHandler.IsEnvelope) {
+                responses.emplace_back(GetResponse());
+                return responses;
+            }
+            if (!myHandler.Root.IsArray()) {
+                throw InvalidRequestFault();
+            }
+
+            // The values are this reader's own, so their results can be moved
+            // out even though Value only hands out const references
+            auto& elements = const_cast<Value::Array&>(myHandler.Root.AsArray());
+            responses.reserve(elements.size());
+            for (auto& element : elements) {
+                if (!element.IsStruct()) {
+                    throw InvalidRequestFault();
+                }
+                auto& members = const_cast<Value::Struct&>(element.AsStruct());
+
+                ValidateJsonrpcVersion(members);
+
+                auto id = members.find(json::ID_NAME);
+                if (id == members.end()) {
+                    throw InvalidRequestFault();
+                }
+
+                auto result = members.find(json::RESULT_NAME);
+                auto error = members.find(json::ERROR_NAME);
+                responses.emplace_back(GetResponse(result != members.end() ? &result->second : nullptr,
+                    error != members.end() ? &error->second : nullptr, id->second));
+            }
+            return responses;
+        }
+
+        Value GetValue() override {
+            if (!myHandler.IsEnvelope) {
+                return std::move(myHandler.Root);
+            }
+
+            // Reassemble the top level object from the pieces picked apart
+            // while parsing
+            Value::Struct data(std::move(myHandler.OtherMembers));
+            if (myHandler.HasJsonrpc) {
+                data.emplace(json::JSONRPC_NAME, std::move(myHandler.Jsonrpc));
+            }
+            if (myHandler.HasMethod && myHandler.MethodId >= 0) {
+                data.emplace(json::METHOD_NAME, myHandler.MethodId);
+            } else if (myHandler.HasMethod) {
+                data.emplace(json::METHOD_NAME, std::move(myHandler.Method));
+            }
+            if (myHandler.HasParams && myHandler.ParamsIsArray) {
+                Value::Array params;
+                params.reserve(myHandler.Parameters.size());
+                for (auto& param : myHandler.Parameters) {
+                    params.emplace_back(std::move(param));
+                }
+                data.emplace(json::PARAMS_NAME, std::move(params));
+            }
+            if (myHandler.HasId) {
+                data.emplace(json::ID_NAME, std::move(myHandler.Id));
+            }
+            if (myHandler.HasResult) {
+                data.emplace(json::RESULT_NAME, std::move(myHandler.Result));
+            }
+            if (myHandler.HasError) {
+                data.emplace(json::ERROR_NAME, std::move(myHandler.Error));
+            }
+            return Value(std::move(data));
+        }
+
+    private:
+        enum class Member {
+            JSONRPC,
+            METHOD,
+            PARAMS,
+            ID,
+            RESULT,
+            FAULT,
+            OTHER
+        };
+
+        struct Frame {
+            enum Kind {
+                ENVELOPE,
+                PARAMS,
+                ARRAY,
+                STRUCT
+            };
+
+            explicit Frame(Kind kind) : FrameKind(kind) {}
+
+            Kind FrameKind;
+            Value::Array Elements;
+            Value::Struct Members;
+            std::string Key;
+            // Narrowest numeric array type that fits the elements so far,
+            // ARRAY once a non-number shows up
+            Value::Type NumericType = Value::Type::INTEGER_32_ARRAY;
+        };
+
+        class Handler {
+        public:
+            Handler(BinaryDetection binaryDetection, const std::string* rawSource)
+                : myBinaryDetection(binaryDetection), myRawSource(rawSource) {
+                myStack.reserve(16);
+            }
+
+            void SetStream(const rapidjson::StringStream* stream) { myStream = stream; }
+
+            bool Null() { return Deliver(Value(), Value::Type::ARRAY); }
+            bool Bool(bool b) { return Deliver(Value(b), Value::Type::ARRAY); }
+            bool Int(int i) { return Deliver(Value(static_cast<int32_t>(i)), Value::Type::INTEGER_32_ARRAY); }
+
+            bool Uint(unsigned u) {
+                if (u <= static_cast<unsigned>(std::numeric_limits<int32_t>::max())) {
+                    return Deliver(Value(static_cast<int32_t>(u)), Value::Type::INTEGER_32_ARRAY);
+                }
+                return Deliver(Value(static_cast<int64_t>(u)), Value::Type::INTEGER_64_ARRAY);
+            }
+
+            bool Int64(int64_t i) {
+                if (i >= std::numeric_limits<int32_t>::min() && i <= std::numeric_limits<int32_t>::max()) {
+                    return Deliver(Value(static_cast<int32_t>(i)), Value::Type::INTEGER_32_ARRAY);
+                }
+                return Deliver(Value(i), Value::Type::INTEGER_64_ARRAY);
+            }
+
+            bool Uint64(uint64_t u) {
+                if (u <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                    return Int64(static_cast<int64_t>(u));
+                }
+                return Deliver(Value(static_cast<double>(u)), Value::Type::DOUBLE_ARRAY);
+            }
+
+            bool Double(double d) { return Deliver(Value(d), Value::Type::DOUBLE_ARRAY); }
+
+            bool RawNumber(const char*, rapidjson::SizeType, bool) {
+                // Only produced with kParseNumbersAsStringsFlag
+                return false;
+            }
+
+            bool String(const char* str, rapidjson::SizeType length, bool) {
+                if (!myStack.empty() && myStack.back().FrameKind == Frame::ENVELOPE) {
+                    if (myMember == Member::JSONRPC) {
+                        HasJsonrpc = true;
+                        Jsonrpc.assign(str, length);
+                        return true;
+                    } else if (myMember == Member::METHOD) {
+                        HasMethod = true;
+                        Method.assign(str, length);
+                        MethodId = -1;
+                        return true;
+                    }
+                }
+                if (IsEnvelopeText()) {
+                    return Deliver(Value(std::string(str, length)), Value::Type::ARRAY);
+                }
+
+                return Deliver(ReadJsonString(str, length, myBinaryDetection), Value::Type::ARRAY);
+            }
+
+            bool StartObject() {
+                if (StartRaw()) {
+                    return true;
+                }
+                myStack.emplace_back(myStack.empty() ? Frame::ENVELOPE : Frame::STRUCT);
+                if (myStack.size() == 1) {
+                    IsEnvelope = true;
+                }
+                return true;
+            }
+
+            bool Key(const char* str, rapidjson::SizeType length, bool) {
+                if (myRawDepth != 0) {
+                    return true;
+                }
+                auto& frame = myStack.back();
+                if (frame.FrameKind == Frame::ENVELOPE) {
+                    myMember = GetMember(str, length);
+                }
+                frame.Key.assign(str, length);
+                return true;
+            }
+
+            bool EndObject(rapidjson::SizeType) {
+                if (myRawDepth != 0) {
+                    return EndRaw();
+                }
+                Frame frame(std::move(myStack.back()));
+                myStack.pop_back();
+                if (frame.FrameKind == Frame::ENVELOPE) {
+                    return true;
+                }
+                return Deliver(Value(std::move(frame.Members)), Value::Type::ARRAY);
+            }
+
+            bool StartArray() {
+                if (StartRaw()) {
+                    return true;
+                }
+                if (!myStack.empty() && myStack.back().FrameKind == Frame::ENVELOPE
+                    && myMember == Member::PARAMS) {
+                    HasParams = true;
+                    ParamsIsArray = true;
+                    Parameters.clear();
+                    myStack.emplace_back(Frame::PARAMS);
+                } else {
+                    myStack.emplace_back(Frame::ARRAY);
+                }
+                return true;
+            }
+
+            bool EndArray(rapidjson::SizeType) {
+                if (myRawDepth != 0) {
+                    return EndRaw();
+                }
+                Frame frame(std::move(myStack.back()));
+                myStack.pop_back();
+                if (frame.FrameKind == Frame::PARAMS) {
+                    return true;
+                }
+                return Deliver(ToValue(frame), Value::Type::ARRAY);
+            }
+
+            bool IsEnvelope = false;
+            Value Root;
+
+            bool HasJsonrpc = false;
+            std::string Jsonrpc;
+            bool HasMethod = false;
+            std::string Method;
+            // A method id in place of the name, see Dispatcher::EnableMethodIds
+            int32_t MethodId = -1;
+            bool HasParams = false;
+            bool ParamsIsArray = false;
+            Request::Parameters Parameters;
+            bool HasId = false;
+            Value Id;
+            bool HasResult = false;
+            Value Result;
+            bool HasError = false;
+            Value Error;
+            Value::Struct OtherMembers;
+
+        private:
+            // Whether the string being read is an id, a batch element's
+            // version or method, or anything inside an error object. These
+            // are text, never binary.
+            bool IsEnvelopeText() const {
+                if (myStack.empty()) {
+                    return false;
+                }
+                if (myStack[0].FrameKind == Frame::ENVELOPE) {
+                    return myStack.size() == 1 ? myMember == Member::ID : myMember == Member::FAULT;
+                }
+                if (myStack.size() < 2 || myStack[0].FrameKind != Frame::ARRAY || myStack[1].FrameKind != Frame::STRUCT) {
+                    return false;
+                }
+                const Member member = GetMember(myStack[1].Key.data(), myStack[1].Key.size());
+                if (myStack.size() == 2) {
+                    return member == Member::JSONRPC || member == Member::METHOD || member == Member::ID;
+                }
+                return member == Member::FAULT;
+            }
+
+            static Member GetMember(const char* key, size_t length) {
+                switch (length) {
+                case sizeof(json::ID_NAME) - 1:
+                    return memcmp(key, json::ID_NAME, length) == 0 ? Member::ID : Member::OTHER;
+                case sizeof(json::ERROR_NAME) - 1:
+                    return memcmp(key, json::ERROR_NAME, length) == 0 ? Member::FAULT : Member::OTHER;
+                case sizeof(json::METHOD_NAME) - 1:
+                    static_assert(sizeof(json::METHOD_NAME) == sizeof(json::PARAMS_NAME)
+                        && sizeof(json::METHOD_NAME) == sizeof(json::RESULT_NAME), "member name lengths");
+                    if (memcmp(key, json::METHOD_NAME, length) == 0) {
+                        return Member::METHOD;
+                    } else if (memcmp(key, json::PARAMS_NAME, length) == 0) {
+                        return Member::PARAMS;
+                    } else if (memcmp(key, json::RESULT_NAME, length) == 0) {
+                        return Member::RESULT;
+                    }
+                    return Member::OTHER;
+                case sizeof(json::JSONRPC_NAME) - 1:
+                    return memcmp(key, json::JSONRPC_NAME, length) == 0 ? Member::JSONRPC : Member::OTHER;
+                default:
+                    return Member::OTHER;
+                }
+            }
+
+            static Value ToValue(Frame& frame) {
+                auto& elements = frame.Elements;
+                if (elements.empty()) {
+                    return Value(std::move(elements));
+                }
+
+                switch (frame.NumericType) {
+                case Value::Type::INTEGER_32_ARRAY: {
+                    Value::Integer32Array array;
+                    array.reserve(elements.size());
+                    for (auto& element : elements) {
+                        array.push_back(element.AsInteger32());
+                    }
+                    return Value(std::move(array));
+                }
+                case Value::Type::INTEGER_64_ARRAY: {
+                    Value::Integer64Array array;
+                    array.reserve(elements.size());
+                    for (auto& element : elements) {
+                        array.push_back(element.AsInteger64());
+                    }
+                    return Value(std::move(array));
+                }
+                case Value::Type::DOUBLE_ARRAY: {
+                    Value::DoubleArray array;
+                    array.reserve(elements.size());
+                    for (auto& element : elements) {
+                        array.push_back(element.AsDouble());
+                    }
+                    return Value(std::move(array));
+                }
+                default:
+                    return Value(std::move(elements));
+                }
+            }
+
+            // A container starting right inside "params" is skipped over when
+            // raw parameters are wanted, StartObject/StartArray are called
+            // just after the opening bracket has been consumed
+            bool StartRaw() {
+                if (myRawDepth != 0) {
+                    ++myRawDepth;
+                    return true;
+                }
+                if (myRawSource != nullptr && !myStack.empty() && myStack.back().FrameKind == Frame::PARAMS) {
+                    myRawDepth = 1;
+                    myRawStart = myStream->Tell() - 1;
+                    return true;
+                }
+                return false;
+            }
+
+            bool EndRaw() {
+                if (--myRawDepth != 0) {
+                    return true;
+                }
+                const size_t end = myStream->Tell();
+                return Deliver(Value(RawJson(myRawSource->substr(myRawStart, end - myRawStart))), Value::Type::ARRAY);
+            }
+
+            // Hands a completed value to whatever contains it; numericType is
+            // the narrowest numeric array type the value fits in
+            bool Deliver(Value value, Value::Type numericType) {
+                if (myRawDepth != 0) {
+                    return true;
+                }
+                if (myStack.empty()) {
+                    Root = std::move(value);
+                    return true;
+                }
+
+                auto& frame = myStack.back();
+                switch (frame.FrameKind) {
+                case Frame::ENVELOPE:
+                    switch (myMember) {
+                    case Member::PARAMS:
+                        HasParams = true;
+                        ParamsIsArray = false;
+                        break;
+                    case Member::METHOD:
+                        if (value.IsInteger32() && value.AsInteger32() >= 0) {
+                            HasMethod = true;
+                            MethodId = value.AsInteger32();
+                            return true;
+                        }
+                        break;
+                    case Member::ID:
+                        HasId = true;
+                        Id = std::move(value);
+                        return true;
+                    case Member::RESULT:
+                        HasResult = true;
+                        Result = std::move(value);
+                        return true;
+                    case Member::FAULT:
+                        HasError = true;
+                        Error = std::move(value);
+                        return true;
+                    case Member::JSONRPC:
+                    case Member::OTHER:
+                        break;
+                    }
+                    OtherMembers[frame.Key] = std::move(value);
+                    return true;
+                case Frame::PARAMS:
+                    Parameters.emplace_back(std::move(value));
+                    return true;
+                case Frame::ARRAY:
+                    if (numericType == Value::Type::ARRAY || frame.NumericType == Value::Type::ARRAY) {
+                        frame.NumericType = Value::Type::ARRAY;
+                    } else if (numericType == Value::Type::DOUBLE_ARRAY || frame.NumericType == Value::Type::DOUBLE_ARRAY) {
+                        frame.NumericType = Value::Type::DOUBLE_ARRAY;
+                    } else if (numericType == Value::Type::INTEGER_64_ARRAY) {
+                        frame.NumericType = Value::Type::INTEGER_64_ARRAY;
+                    }
+                    frame.Elements.emplace_back(std::move(value));
+                    return true;
+                case Frame::STRUCT:
+                    frame.Members[frame.Key] = std::move(value);
+                    return true;
+                }
+                return false;
+            }
+
+            BinaryDetection myBinaryDetection;
+            const std::string* myRawSource;
+            const rapidjson::StringStream* myStream = nullptr;
+            size_t myRawDepth = 0;
+            size_t myRawStart = 0;
+            Member myMember = Member::OTHER;
+            std::vector<Frame> myStack;
+        };
+
+        void ValidateJsonrpcVersion() const {
+            if (!myHandler.HasJsonrpc || myHandler.Jsonrpc != json::JSONRPC_VERSION_2_0) {
+                throw InvalidRequestFault();
+            }
+        }
+
+        static void ValidateJsonrpcVersion(const Value::Struct& members) {
+            auto jsonrpc = members.find(json::JSONRPC_NAME);
+            if (jsonrpc == members.end() || !jsonrpc->second.IsString()
+                || jsonrpc->second.AsString() != json::JSONRPC_VERSION_2_0) {
+                throw InvalidRequestFault();
+            }
+        }
+
+        static Response GetResponse(Value* result, const Value* error, Value& id) {
+            if (result != nullptr) {
+                if (error != nullptr) {
+                    throw InvalidRequestFault();
+                }
+                return Response(std::move(*result), GetId(id));
+            } else if (error != nullptr) {
+                if (!error->IsStruct()) {
+                    throw InvalidRequestFault();
+                }
+                auto& members = error->AsStruct();
+                auto code = members.find(json::ERROR_CODE_NAME);
+                if (code == members.end() || !code->second.IsInteger32()) {
+                    throw InvalidRequestFault();
+                }
+                auto message = members.find(json::ERROR_MESSAGE_NAME);
+                if (message == members.end() || !message->second.IsString()) {
+                    throw InvalidRequestFault();
+                }
+
+                return Response(code->second.AsInteger32(), message->second.AsString(), GetId(id));
+            } else {
+                throw InvalidRequestFault();
+            }
+        }
+
+        static Value GetId(Value& id) {
+            if (id.IsString() || id.IsInteger32() || id.IsInteger64() || id.IsNil()) {
+                return std::move(id);
+            }
+
+            throw InvalidRequestFault();
+        }
+
+        Handler myHandler;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_JSONSAXREADER_H
@@ -0,0 +1,258 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_JSONSIZER_H
+#define JSONRPC_LEAN_JSONSIZER_H
+
+#include "json.h"
+#include "jsonwriter.h"
+#include "rawjson.h"
+#include "util.h"
+#include "value.h"
+
+#define RAPIDJSON_NO_SIZETYPEDEFINE
+namespace rapidjson { typedef ::std::size_t SizeType; }
+
+#include <rapidjson/internal/dtoa.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace jsonrpc {
+
+    // Computes the exact number of bytes JsonWriter produces for the same
+    // calls, without producing them. It has JsonWriter's member functions but
+    // is not a Writer: it is meant for the templated Write functions of
+    // Value, Request and Response, e.g.
+    //
+    //   JsonSizer sizer;
+    //   response.Write(sizer);
+    //   JsonWriter writer;
+    //   writer.Reserve(sizer.GetSize());
+    //   response.Write(writer);
+    //
+    // Doubles are formatted to learn their length, everything else is counted.
+    class JsonSizer final {
+    public:
+        // Must match the JsonWriter's, RawJson that it turns into segments of
+        // their own takes no space in the buffer
+        explicit JsonSizer(size_t segmentThreshold = 0) : mySegmentThreshold(segmentThreshold) {
+            myLevels.reserve(16);
+        }
+
+        size_t GetSize() const { return mySize; }
+
+        void StartDocument() {}
+        void EndDocument() {}
+        void StartBatch() { StartContainer(); }
+        void EndBatch() { EndContainer(); }
+
+        void StartRequest(const std::string& methodName, const Value& id) {
+            StartContainer();
+            AddKey(sizeof(json::JSONRPC_NAME) - 1);
+            AddValue(sizeof(json::JSONRPC_VERSION_2_0) - 1 + 2);
+            AddKey(sizeof(json::METHOD_NAME) - 1);
+            AddValue(GetStringSize(methodName.data(), methodName.size()));
+            AddId(id);
+            AddKey(sizeof(json::PARAMS_NAME) - 1);
+            StartContainer();
+        }
+
+        void StartRequestById(int32_t methodId, const Value& id) {
+            StartContainer();
+            AddKey(sizeof(json::JSONRPC_NAME) - 1);
+            AddValue(sizeof(json::JSONRPC_VERSION_2_0) - 1 + 2);
+            AddKey(sizeof(json::METHOD_NAME) - 1);
+            AddValue(GetIntegerSize(methodId));
+            AddId(id);
+            AddKey(sizeof(json::PARAMS_NAME) - 1);
+            StartContainer();
+        }
+
+        void EndRequest() {
+            EndContainer();
+            EndContainer();
+        }
+
+        void StartParameter() {}
+        void EndParameter() {}
+
+        void StartResponse(const Value& id) {
+            StartContainer();
+            AddKey(sizeof(json::JSONRPC_NAME) - 1);
+            AddValue(sizeof(json::JSONRPC_VERSION_2_0) - 1 + 2);
+            AddId(id);
+            AddKey(sizeof(json::RESULT_NAME) - 1);
+        }
+
+        void EndResponse() {
+            EndContainer();
+        }
+
+        void StartFaultResponse(const Value& id) {
+            StartContainer();
+            AddKey(sizeof(json::JSONRPC_NAME) - 1);
+            AddValue(sizeof(json::JSONRPC_VERSION_2_0) - 1 + 2);
+            AddId(id);
+        }
+
+        void EndFaultResponse() {
+            EndContainer();
+        }
+
+        void WriteFault(int32_t code, const std::string& string) {
+            AddKey(sizeof(json::ERROR_NAME) - 1);
+            StartContainer();
+            AddKey(sizeof(json::ERROR_CODE_NAME) - 1);
+            AddValue(GetIntegerSize(code));
+            AddKey(sizeof(json::ERROR_MESSAGE_NAME) - 1);
+            AddValue(GetStringSize(string.data(), string.size()));
+            EndContainer();
+        }
+
+        void StartArray() { StartContainer(); }
+        void StartSizedArray(size_t) { StartContainer(); }
+        void EndArray() { EndContainer(); }
+        void StartStruct() { StartContainer(); }
+        void StartSizedStruct(size_t) { StartContainer(); }
+        void EndStruct() { EndContainer(); }
+
+        void StartStructElement(const std::string& name) {
+            AddValue(GetStringSize(name.data(), name.size()));
+        }
+
+        void EndStructElement() {}
+
+        void WriteBinary(const char*, size_t size) {
+            AddValue(util::Base64EncodedSize(size) + 2);
+        }
+
+        void WriteNull() { AddValue(4); }
+        void Write(bool value) { AddValue(value ? 4 : 5); }
+
+        void Write(double value) {
+            // rapidjson writes nothing at all for these
+            AddValue(std::isfinite(value) ? GetDoubleSize(value) : 0);
+        }
+
+        void Write(int32_t value) { AddValue(GetIntegerSize(value)); }
+        void Write(int64_t value) { AddValue(GetIntegerSize(value)); }
+
+        void Write(const std::string& value) {
+            AddValue(GetStringSize(value.data(), value.size()));
+        }
+
+        void WriteRawJson(const RawJson& value) {
+            const size_t size = value.GetJson().size();
+            AddValue(mySegmentThreshold != 0 && size >= mySegmentThreshold ? 0 : size);
+        }
+
+        void WriteArray(const int32_t* values, size_t size) {
+            size_t total = 0;
+            for (size_t i = 0; i < size; ++i) {
+                total += GetIntegerSize(values[i]);
+            }
+            AddNumberArray(total, size);
+        }
+
+        void WriteArray(const int64_t* values, size_t size) {
+            size_t total = 0;
+            for (size_t i = 0; i < size; ++i) {
+                total += GetIntegerSize(values[i]);
+            }
+            AddNumberArray(total, size);
+        }
+
+        void WriteArray(const double* values, size_t size) {
+            size_t total = 0;
+            for (size_t i = 0; i < size; ++i) {
+                // Written as null by JsonWriter
+                total += std::isfinite(values[i]) ? GetDoubleSize(values[i]) : 4;
+            }
+            AddNumberArray(total, size);
+        }
+
+    private:
+        static size_t GetIntegerSize(int64_t value) {
+            size_t size = value < 0 ? 2 : 1;
+            uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+            while (magnitude >= 10) {
+                magnitude /= 10;
+                ++size;
+            }
+            return size;
+        }
+
+        static size_t GetDoubleSize(double value) {
+            char buffer[25];
+            return static_cast<size_t>(rapidjson::internal::dtoa(value, buffer) - buffer);
+        }
+
+        // Quoted and escaped like JsonWriter does it
+        static size_t GetStringSize(const char* data, size_t size) {
+            size_t total = size + 2;
+            for (size_t i = 0;;) {
+                i += util::FindJsonEscape(data + i, size - i);
+                if (i == size) {
+                    break;
+                }
+                total += JSON_ESCAPES[static_cast<uint8_t>(data[i++])] == 'u' ? 5 : 1;
+            }
+            return total;
+        }
+
+        // The separator rapidjson puts before every value or key but the
+        // first in a container, ',' or ':'
+        void Prefix() {
+            if (!myLevels.empty() && myLevels.back()++ != 0) {
+                ++mySize;
+            }
+        }
+
+        void AddValue(size_t size) {
+            Prefix();
+            mySize += size;
+        }
+
+        void AddKey(size_t length) {
+            AddValue(length + 2);
+        }
+
+        void AddId(const Value& id) {
+            if (id.IsString() || id.IsInteger32() || id.IsInteger64() || id.IsNil()) {
+                AddKey(sizeof(json::ID_NAME) - 1);
+                if (id.IsString()) {
+                    AddValue(GetStringSize(id.AsString().data(), id.AsString().size()));
+                } else if (id.IsInteger32() || id.IsInteger64()) {
+                    AddValue(GetIntegerSize(id.AsInteger64()));
+                } else {
+                    AddValue(4);
+                }
+            }
+        }
+
+        void AddNumberArray(size_t total, size_t size) {
+            AddValue(total + (size != 0 ? size - 1 : 0) + 2);
+        }
+
+        void StartContainer() {
+            AddValue(1);
+            myLevels.push_back(0);
+        }
+
+        void EndContainer() {
+            myLevels.pop_back();
+            ++mySize;
+        }
+
+        size_t mySegmentThreshold;
+        size_t mySize = 0;
+        std::vector<size_t> myLevels;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_JSONSIZER_H
@@ -17,13 +17,54 @@
 namespace rapidjson { typedef ::std::size_t SizeType; }
 
 #include <rapidjson/writer.h>
-#include <rapidjson/stringbuffer.h>
+#include <rapidjson/internal/dtoa.h>
+#include <rapidjson/internal/itoa.h>
+
+#include <cmath>
 
 namespace jsonrpc {
 
+    // The character following the backslash for each character a JSON string
+    // has to escape, 'u' for \u00XX
+    const char JSON_ESCAPES['\\' + 1] = {
+        'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+        'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+        0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\'
+    };
+
     class JsonWriter final : public Writer {
     public:
-        JsonWriter() : myRequestData(new JsonFormattedData()) {
+        // RawJson values of at least segmentThreshold bytes are not copied
+        // into the output but referenced as a segment of their own, see
+        // FormattedData::GetSegments(); 0 turns this off
+        explicit JsonWriter(size_t segmentThreshold = 0)
+            : myRequestData(new JsonFormattedData()),
+            myWriter(myRequestData->Writer),
+            mySegmentThreshold(segmentThreshold) {
+        }
+
+        // Writes into a transport supplied buffer, see JsonFormattedData
+        explicit JsonWriter(std::string buffer, size_t segmentThreshold = 0)
+            : myRequestData(new JsonFormattedData(std::move(buffer))),
+            myWriter(myRequestData->Writer),
+            mySegmentThreshold(segmentThreshold) {
+        }
+
+        // Reject string values that are not well-formed UTF-8 with an
+        // InternalErrorFault instead of passing them through
+        JsonWriter& SetUtf8Validation(bool utf8Validation = true) {
+            myUtf8Validation = utf8Validation;
+            return *this;
+        }
+
+        // Makes room for size more bytes of output, plus the little extra the
+        // writer may reserve beyond what it ends up writing; with the exact
+        // size from a JsonSizer the buffer then never has to grow
+        void Reserve(size_t size) {
+            myRequestData->GetBuffer().Reserve(size + MAX_RESERVE + 1);
         }
 
         // Writer
@@ -39,24 +80,47 @@ namespace jsonrpc {
             // Empty
         }
 
+        void StartBatch() override {
+            myWriter.StartArray();
+        }
+
+        void EndBatch() override {
+            myWriter.EndArray();
+        }
+
         void StartRequest(const std::string& methodName, const Value& id) override {
-            myRequestData->Writer.StartObject();
+            myWriter.StartObject();
 
-            myRequestData->Writer.Key(json::JSONRPC_NAME, sizeof(json::JSONRPC_NAME) - 1);
-            myRequestData->Writer.String(json::JSONRPC_VERSION_2_0, sizeof(json::JSONRPC_VERSION_2_0) - 1);
+            myWriter.Key(json::JSONRPC_NAME, sizeof(json::JSONRPC_NAME) - 1);
+            myWriter.String(json::JSONRPC_VERSION_2_0, sizeof(json::JSONRPC_VERSION_2_0) - 1);
 
-            myRequestData->Writer.Key(json::METHOD_NAME, sizeof(json::METHOD_NAME) - 1);
-            myRequestData->Writer.String(methodName.data(), methodName.size(), true);
+            myWriter.Key(json::METHOD_NAME, sizeof(json::METHOD_NAME) - 1);
+            myWriter.String(methodName.data(), methodName.size(), true);
 
             WriteId(id);
 
-            myRequestData->Writer.Key(json::PARAMS_NAME, sizeof(json::PARAMS_NAME) - 1);
-            myRequestData->Writer.StartArray();
+            myWriter.Key(json::PARAMS_NAME, sizeof(json::PARAMS_NAME) - 1);
+            myWriter.StartArray();
+        }
+
+        void StartRequestById(int32_t methodId, const Value& id) override {
+            myWriter.StartObject();
+
+            myWriter.Key(json::JSONRPC_NAME, sizeof(json::JSONRPC_NAME) - 1);
+            myWriter.String(json::JSONRPC_VERSION_2_0, sizeof(json::JSONRPC_VERSION_2_0) - 1);
+
+            myWriter.Key(json::METHOD_NAME, sizeof(json::METHOD_NAME) - 1);
+            myWriter.Int(methodId);
+
+            WriteId(id);
+
+            myWriter.Key(json::PARAMS_NAME, sizeof(json::PARAMS_NAME) - 1);
+            myWriter.StartArray();
         }
 
         void EndRequest() override {
-            myRequestData->Writer.EndArray();
-            myRequestData->Writer.EndObject();
+            myWriter.EndArray();
+            myWriter.EndObject();
         }
 
         void StartParameter() override {
@@ -68,115 +132,239 @@ namespace jsonrpc {
         }
 
         void StartResponse(const Value& id) override {
-            myRequestData->Writer.StartObject();
+            myWriter.StartObject();
 
-            myRequestData->Writer.Key(json::JSONRPC_NAME, sizeof(json::JSONRPC_NAME) - 1);
-            myRequestData->Writer.String(json::JSONRPC_VERSION_2_0, sizeof(json::JSONRPC_VERSION_2_0) - 1);
+            myWriter.Key(json::JSONRPC_NAME, sizeof(json::JSONRPC_NAME) - 1);
+            myWriter.String(json::JSONRPC_VERSION_2_0, sizeof(json::JSONRPC_VERSION_2_0) - 1);
 
             WriteId(id);
 
-            myRequestData->Writer.Key(json::RESULT_NAME, sizeof(json::RESULT_NAME) - 1);
+            myWriter.Key(json::RESULT_NAME, sizeof(json::RESULT_NAME) - 1);
         }
 
         void EndResponse() override {
-            myRequestData->Writer.EndObject();
+            myWriter.EndObject();
         }
 
         void StartFaultResponse(const Value& id) override {
-            myRequestData->Writer.StartObject();
+            myWriter.StartObject();
 
-            myRequestData->Writer.Key(json::JSONRPC_NAME, sizeof(json::JSONRPC_NAME) - 1);
-            myRequestData->Writer.String(json::JSONRPC_VERSION_2_0, sizeof(json::JSONRPC_VERSION_2_0) - 1);
+            myWriter.Key(json::JSONRPC_NAME, sizeof(json::JSONRPC_NAME) - 1);
+            myWriter.String(json::JSONRPC_VERSION_2_0, sizeof(json::JSONRPC_VERSION_2_0) - 1);
 
             WriteId(id);
         }
 
         void EndFaultResponse() override {
-            myRequestData->Writer.EndObject();
+            myWriter.EndObject();
         }
 
         void WriteFault(int32_t code, const std::string& string) override {
-            myRequestData->Writer.Key(json::ERROR_NAME, sizeof(json::ERROR_NAME) - 1);
-            myRequestData->Writer.StartObject();
+            myWriter.Key(json::ERROR_NAME, sizeof(json::ERROR_NAME) - 1);
+            myWriter.StartObject();
 
-            myRequestData->Writer.Key(json::ERROR_CODE_NAME, sizeof(json::ERROR_CODE_NAME) - 1);
-            myRequestData->Writer.Int(code);
+            myWriter.Key(json::ERROR_CODE_NAME, sizeof(json::ERROR_CODE_NAME) - 1);
+            myWriter.Int(code);
 
-            myRequestData->Writer.Key(json::ERROR_MESSAGE_NAME, sizeof(json::ERROR_MESSAGE_NAME) - 1);
-            myRequestData->Writer.String(string.data(), string.size(), true);
+            myWriter.Key(json::ERROR_MESSAGE_NAME, sizeof(json::ERROR_MESSAGE_NAME) - 1);
+            WriteString(string.data(), string.size());
 
-            myRequestData->Writer.EndObject();
+            myWriter.EndObject();
         }
 
         void StartArray() override {
-            myRequestData->Writer.StartArray();
+            myWriter.StartArray();
+        }
+
+        void StartSizedArray(size_t) override {
+            myWriter.StartArray();
         }
 
         void EndArray() override {
-            myRequestData->Writer.EndArray();
+            myWriter.EndArray();
         }
 
         void StartStruct() override {
-            myRequestData->Writer.StartObject();
+            myWriter.StartObject();
+        }
+
+        void StartSizedStruct(size_t) override {
+            myWriter.StartObject();
         }
 
         void EndStruct() override {
-            myRequestData->Writer.EndObject();
+            myWriter.EndObject();
         }
 
         void StartStructElement(const std::string& name) override {
-            myRequestData->Writer.Key(name.data(), name.size(), true);
+            myWriter.Key(name.data(), name.size(), true);
         }
 
         void EndStructElement() override {
             // Empty
         }
 
+        // Standard base64, encoded straight into the output buffer
         void WriteBinary(const char* data, size_t size) override {
-            myRequestData->Writer.String(data, size, true);
+            myWriter.RawValue("\"", 1, rapidjson::kStringType);
+
+            const size_t length = util::Base64EncodedSize(size);
+            char* const out = myRequestData->GetBuffer().Push(length + 1);
+            *util::Base64EncodeTo(data, size, out) = '"';
         }
 
         void WriteNull() override {
-            myRequestData->Writer.Null();
+            myWriter.Null();
         }
 
         void Write(bool value) override {
-            myRequestData->Writer.Bool(value);
+            myWriter.Bool(value);
         }
 
         void Write(double value) override {
-            myRequestData->Writer.Double(value);
+            myWriter.Double(value);
         }
 
         void Write(int32_t value) override {
-            myRequestData->Writer.Int(value);
+            myWriter.Int(value);
         }
 
         void Write(int64_t value) override {
-            myRequestData->Writer.Int64(value);
+            myWriter.Int64(value);
         }
 
         void Write(const std::string& value) override {
-            myRequestData->Writer.String(value.data(), value.size(), true);
+            WriteString(value.data(), value.size());
+        }
+
+        void WriteRawJson(const RawJson& value) override {
+            auto& json = value.GetJson();
+            if (mySegmentThreshold != 0 && json.size() >= mySegmentThreshold) {
+                // Let rapidjson put out the separator, then splice the text in
+                myWriter.RawValue("", 0, rapidjson::kObjectType);
+                myRequestData->AddBorrowed(value.GetSharedJson());
+                return;
+            }
+            myWriter.RawValue(json.data(), json.size(), rapidjson::kObjectType);
+        }
+
+        void WriteArray(const int32_t* values, size_t size) override {
+            WriteNumberArray(values, size, 11, [](int32_t value, char* buffer) {
+                return rapidjson::internal::i32toa(value, buffer);
+            });
+        }
+
+        void WriteArray(const int64_t* values, size_t size) override {
+            WriteNumberArray(values, size, 20, [](int64_t value, char* buffer) {
+                return rapidjson::internal::i64toa(value, buffer);
+            });
+        }
+
+        void WriteArray(const double* values, size_t size) override {
+            WriteNumberArray(values, size, 25, [](double value, char* buffer) {
+                if (!std::isfinite(value)) {
+                    // Not representable in JSON
+                    memcpy(buffer, "null", 4);
+                    return buffer + 4;
+                }
+                return rapidjson::internal::dtoa(value, buffer);
+            });
         }
 
     private:
+        // The most any single write reserves in the buffer up front
+        static const size_t MAX_RESERVE = 8 * 1024;
+
+        // Escapes the same characters as rapidjson::Writer::String, but
+        // copies the runs in between in bulk instead of one character at a
+        // time. The input is taken in blocks so that the worst case of six
+        // output characters per input character can be reserved up front
+        // without reserving six times the whole string.
+        void WriteString(const char* data, size_t size) {
+            if (myUtf8Validation && !util::IsValidUtf8(data, size)) {
+                throw InternalErrorFault("Invalid UTF-8 in string value");
+            }
+
+            myWriter.RawValue("\"", 1, rapidjson::kStringType);
+
+            static const char hexDigits[] = "0123456789ABCDEF";
+            auto& buffer = myRequestData->GetBuffer();
+            const size_t blockSize = MAX_RESERVE / 6;
+            for (size_t block = 0; block < size; block += blockSize) {
+                const size_t end = size - block < blockSize ? size : block + blockSize;
+                const size_t reserved = 6 * (end - block);
+                char* const begin = buffer.Push(reserved);
+                char* out = begin;
+                for (size_t i = block;;) {
+                    const size_t run = util::FindJsonEscape(data + i, end - i);
+                    memcpy(out, data + i, run);
+                    out += run;
+                    i += run;
+                    if (i == end) {
+                        break;
+                    }
+
+                    const uint8_t c = static_cast<uint8_t>(data[i++]);
+                    const char escape = JSON_ESCAPES[c];
+                    *out++ = '\\';
+                    *out++ = escape;
+                    if (escape == 'u') {
+                        *out++ = '0';
+                        *out++ = '0';
+                        *out++ = hexDigits[c >> 4];
+                        *out++ = hexDigits[c & 0xf];
+                    }
+                }
+                buffer.Pop(reserved - static_cast<size_t>(out - begin));
+            }
+            buffer.Put('"');
+        }
+
+        // The opening bracket goes through rapidjson so that it keeps track of
+        // separators, the elements are then formatted straight into the output
+        // buffer with room reserved for the worst case up front
+        template<typename T, typename Formatter>
+        void WriteNumberArray(const T* values, size_t size, size_t maxLength, Formatter format) {
+            myWriter.RawValue("[", 1, rapidjson::kArrayType);
+
+            // In blocks, so that no more than MAX_RESERVE is reserved at once
+            auto& buffer = myRequestData->GetBuffer();
+            const size_t blockSize = (MAX_RESERVE - 1) / (maxLength + 1);
+            for (size_t block = 0; block < size; block += blockSize) {
+                const size_t end = size - block < blockSize ? size : block + blockSize;
+                const size_t reserved = (end - block) * (maxLength + 1);
+                char* const begin = buffer.Push(reserved);
+                char* out = begin;
+                for (size_t i = block; i < end; ++i) {
+                    if (i != 0) {
+                        *out++ = ',';
+                    }
+                    out = format(values[i], out);
+                }
+                buffer.Pop(reserved - static_cast<size_t>(out - begin));
+            }
+            buffer.Put(']');
+        }
+
         void WriteId(const Value& id) {
             if (id.IsString() || id.IsInteger32() || id.IsInteger64() || id.IsNil()) {
-                myRequestData->Writer.Key(json::ID_NAME, sizeof(json::ID_NAME) - 1);
+                myWriter.Key(json::ID_NAME, sizeof(json::ID_NAME) - 1);
                 if (id.IsString()) {
-                    myRequestData->Writer.String(id.AsString().data(), id.AsString().size(), true);
+                    myWriter.String(id.AsString().data(), id.AsString().size(), true);
                 } else if (id.IsInteger32()) {
-                    myRequestData->Writer.Int(id.AsInteger32());
+                    myWriter.Int(id.AsInteger32());
                 } else if (id.IsInteger64()) {
-                    myRequestData->Writer.Int64(id.AsInteger64());
+                    myWriter.Int64(id.AsInteger64());
                 } else {
-                    myRequestData->Writer.Null();
+                    myWriter.Null();
                 }
             }
         }
 
         std::shared_ptr<JsonFormattedData> myRequestData;
+        rapidjson::Writer<OutputBuffer>& myWriter;
+        size_t mySegmentThreshold;
+        bool myUtf8Validation = false;
     };
 
 } // namespace jsonrpc
@@ -0,0 +1,57 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_MSGPACK_H
+#define JSONRPC_LEAN_MSGPACK_H
+
+#include <cstdint>
+
+namespace jsonrpc {
+    namespace msgpack {
+
+        // Format bytes, see https://github.com/msgpack/msgpack/blob/master/spec.md
+        const uint8_t POSITIVE_FIXINT_MAX = 0x7f;
+        const uint8_t FIXMAP = 0x80;
+        const uint8_t FIXARRAY = 0x90;
+        const uint8_t FIXSTR = 0xa0;
+        const uint8_t NIL = 0xc0;
+        const uint8_t BOOL_FALSE = 0xc2;
+        const uint8_t BOOL_TRUE = 0xc3;
+        const uint8_t BIN8 = 0xc4;
+        const uint8_t BIN16 = 0xc5;
+        const uint8_t BIN32 = 0xc6;
+        const uint8_t EXT8 = 0xc7;
+        const uint8_t EXT16 = 0xc8;
+        const uint8_t EXT32 = 0xc9;
+        const uint8_t FLOAT32 = 0xca;
+        const uint8_t FLOAT64 = 0xcb;
+        const uint8_t UINT8 = 0xcc;
+        const uint8_t UINT16 = 0xcd;
+        const uint8_t UINT32 = 0xce;
+        const uint8_t UINT64 = 0xcf;
+        const uint8_t INT8 = 0xd0;
+        const uint8_t INT16 = 0xd1;
+        const uint8_t INT32 = 0xd2;
+        const uint8_t INT64 = 0xd3;
+        const uint8_t FIXEXT1 = 0xd4;
+        const uint8_t FIXEXT16 = 0xd8;
+        const uint8_t STR8 = 0xd9;
+        const uint8_t STR16 = 0xda;
+        const uint8_t STR32 = 0xdb;
+        const uint8_t ARRAY16 = 0xdc;
+        const uint8_t ARRAY32 = 0xdd;
+        const uint8_t MAP16 = 0xde;
+        const uint8_t MAP32 = 0xdf;
+        const uint8_t NEGATIVE_FIXINT_MIN = 0xe0;
+
+        // Elements a fix form header holds at most
+        const uint32_t FIXMAP_MAX = 15;
+        const uint32_t FIXARRAY_MAX = 15;
+        const uint32_t FIXSTR_MAX = 31;
+
+    } // namespace msgpack
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_MSGPACK_H
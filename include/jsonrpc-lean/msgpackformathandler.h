@@ -0,0 +1,70 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_MSGPACKFORMATHANDLER_H
+#define JSONRPC_LEAN_MSGPACKFORMATHANDLER_H
+
+#include "formathandler.h"
+#include "msgpackreader.h"
+#include "msgpackwriter.h"
+
+#include <memory>
+
+namespace jsonrpc {
+
+    const char APPLICATION_MSGPACK[] = "application/msgpack";
+
+    // JSON-RPC 2.0 messages encoded as MessagePack instead of JSON text, for
+    // peers that both speak it; register it alongside JsonFormatHandler and
+    // Server picks it by content type
+    class MsgPackFormatHandler : public FormatHandler {
+    public:
+        explicit MsgPackFormatHandler() {}
+
+        // FormatHandler
+        bool CanHandleRequest(const std::string& contentType) override {
+            return contentType == APPLICATION_MSGPACK;
+        }
+
+        std::string GetContentType() override {
+            return APPLICATION_MSGPACK;
+        }
+
+        bool UsesId() override {
+            return true;
+        }
+
+        std::unique_ptr<Reader> CreateReader(const std::string& data) override {
+            return std::unique_ptr<Reader>(std::make_unique<MsgPackReader>(data));
+        }
+
+        std::unique_ptr<Writer> CreateWriter() override {
+            return std::unique_ptr<Writer>(std::make_unique<MsgPackWriter>());
+        }
+
+        std::shared_ptr<FormattedData> FormatRequest(const std::string& methodName,
+            const Request::Parameters& params, const Value& id) override {
+            MsgPackWriter writer;
+            Request::Write(methodName, params, id, writer);
+            return writer.GetData();
+        }
+
+        std::shared_ptr<FormattedData> FormatRequest(int32_t methodId,
+            const Request::Parameters& params, const Value& id) override {
+            MsgPackWriter writer;
+            Request::Write(methodId, params, id, writer);
+            return writer.GetData();
+        }
+
+        std::shared_ptr<FormattedData> FormatResponse(const Response& response) override {
+            MsgPackWriter writer;
+            response.Write(writer);
+            return writer.GetData();
+        }
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_MSGPACKFORMATHANDLER_H
@@ -0,0 +1,634 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_MSGPACKREADER_H
+#define JSONRPC_LEAN_MSGPACKREADER_H
+
+#include "reader.h"
+#include "fault.h"
+#include "json.h"
+#include "msgpack.h"
+#include "util.h"
+#include "request.h"
+#include "response.h"
+#include "value.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace jsonrpc {
+
+    // Reads what MsgPackWriter writes, or any MessagePack map with the same
+    // keys. bin values become BINARY and str values STRING, ext types are
+    // rejected. Decodes straight from data, which has to outlive the reader.
+    class MsgPackReader final : public Reader {
+    public:
+        explicit MsgPackReader(const std::string& data)
+            : myBegin(data.data()), myEnd(data.data() + data.size()), myPosition(myBegin) {
+        }
+
+        // Reader
+        Request GetRequest() override {
+            myPosition = myBegin;
+            const size_t size = ReadMapHeader();
+
+            bool hasVersion = false;
+            bool hasMethod = false;
+            bool hasParams = false;
+            bool hasId = false;
+            std::string method;
+            int32_t methodId = -1;
+            Request::Parameters parameters;
+            Value id;
+
+            // First occurrence wins, as with rapidjson's FindMember
+            for (size_t i = 0; i < size; ++i) {
+                switch (ReadKey()) {
+                case Member::JSONRPC:
+                    if (!hasVersion) {
+                        ValidateJsonrpcVersion();
+                        hasVersion = true;
+                        continue;
+                    }
+                    break;
+                case Member::METHOD:
+                    if (!hasMethod) {
+                        ReadMethod(method, methodId);
+                        hasMethod = true;
+                        continue;
+                    }
+                    break;
+                case Member::PARAMS:
+                    if (!hasParams) {
+                        parameters = ReadParameters();
+                        hasParams = true;
+                        continue;
+                    }
+                    break;
+                case Member::ID:
+                    if (!hasId) {
+                        id = ReadId();
+                        hasId = true;
+                        continue;
+                    }
+                    break;
+                default:
+                    break;
+                }
+                ReadValue(0);
+            }
+            CheckEnd();
+
+            if (!hasVersion || !hasMethod) {
+                throw InvalidRequestFault();
+            }
+
+            if (!hasId) {
+                // Notification
+                id = false;
+            }
+
+            if (methodId >= 0) {
+                return Request(methodId, std::move(parameters), std::move(id));
+            }
+            return Request(std::move(method), std::move(parameters), std::move(id));
+        }
+
+        Response GetResponse() override {
+            myPosition = myBegin;
+            Response response = ReadResponse();
+            CheckEnd();
+            return response;
+        }
+
+        Value GetValue() override {
+            myPosition = myBegin;
+            Value value = ReadValue(0);
+            CheckEnd();
+            return value;
+        }
+
+    private:
+        enum class Member {
+            OTHER,
+            JSONRPC,
+            METHOD,
+            PARAMS,
+            ID,
+            RESULT,
+            FAULT
+        };
+
+        // Deeper nesting is rejected rather than risking the stack
+        static const size_t MAX_DEPTH = 512;
+
+        static void ThrowParseError(const char* reason) {
+            throw ParseErrorFault(std::string("Parse error: ") + reason);
+        }
+
+        const char* ReadBytes(size_t size) {
+            if (static_cast<size_t>(myEnd - myPosition) < size) {
+                ThrowParseError("unexpected end of data");
+            }
+            const char* const bytes = myPosition;
+            myPosition += size;
+            return bytes;
+        }
+
+        uint8_t ReadByte() {
+            return static_cast<uint8_t>(*ReadBytes(1));
+        }
+
+        uint8_t PeekByte() const {
+            if (myPosition == myEnd) {
+                ThrowParseError("unexpected end of data");
+            }
+            return static_cast<uint8_t>(*myPosition);
+        }
+
+        void CheckEnd() const {
+            if (myPosition != myEnd) {
+                ThrowParseError("trailing data");
+            }
+        }
+
+        // Every element takes at least minSize bytes, which bounds what a
+        // corrupt header can make the reader reserve
+        size_t CheckCount(size_t count, size_t minSize) const {
+            if (count > static_cast<size_t>(myEnd - myPosition) / minSize) {
+                ThrowParseError("unexpected end of data");
+            }
+            return count;
+        }
+
+        // The length of a str, or false without consuming anything for
+        // other types
+        bool ReadStringHeader(size_t& size) {
+            const uint8_t type = PeekByte();
+            if ((type & 0xe0) == msgpack::FIXSTR) {
+                ++myPosition;
+                size = type & 0x1f;
+            } else if (type == msgpack::STR8) {
+                ++myPosition;
+                size = ReadByte();
+            } else if (type == msgpack::STR16) {
+                ++myPosition;
+                size = util::LoadBigEndian16(ReadBytes(2));
+            } else if (type == msgpack::STR32) {
+                ++myPosition;
+                size = util::LoadBigEndian32(ReadBytes(4));
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        std::string ReadString() {
+            size_t size;
+            if (!ReadStringHeader(size)) {
+                throw InvalidRequestFault();
+            }
+            return std::string(ReadBytes(size), size);
+        }
+
+        size_t ReadMapHeader() {
+            const uint8_t type = PeekByte();
+            size_t size;
+            if ((type & 0xf0) == msgpack::FIXMAP) {
+                ++myPosition;
+                size = type & 0x0f;
+            } else if (type == msgpack::MAP16) {
+                ++myPosition;
+                size = util::LoadBigEndian16(ReadBytes(2));
+            } else if (type == msgpack::MAP32) {
+                ++myPosition;
+                size = util::LoadBigEndian32(ReadBytes(4));
+            } else {
+                throw InvalidRequestFault();
+            }
+            return CheckCount(size, 2);
+        }
+
+        // Consumes the key of an envelope member, keys that are not strings
+        // are OTHER
+        Member ReadKey() {
+            size_t size;
+            if (!ReadStringHeader(size)) {
+                ReadValue(0);
+                return Member::OTHER;
+            }
+            const char* const key = ReadBytes(size);
+            const auto matches = [key, size](const char* name, size_t length) {
+                return size == length && memcmp(key, name, length) == 0;
+            };
+            if (matches(json::JSONRPC_NAME, sizeof(json::JSONRPC_NAME) - 1)) {
+                return Member::JSONRPC;
+            } else if (matches(json::METHOD_NAME, sizeof(json::METHOD_NAME) - 1)) {
+                return Member::METHOD;
+            } else if (matches(json::PARAMS_NAME, sizeof(json::PARAMS_NAME) - 1)) {
+                return Member::PARAMS;
+            } else if (matches(json::ID_NAME, sizeof(json::ID_NAME) - 1)) {
+                return Member::ID;
+            } else if (matches(json::RESULT_NAME, sizeof(json::RESULT_NAME) - 1)) {
+                return Member::RESULT;
+            } else if (matches(json::ERROR_NAME, sizeof(json::ERROR_NAME) - 1)) {
+                return Member::FAULT;
+            }
+            return Member::OTHER;
+        }
+
+        void ValidateJsonrpcVersion() {
+            if (ReadString() != json::JSONRPC_VERSION_2_0) {
+                throw InvalidRequestFault();
+            }
+        }
+
+        size_t ReadArrayHeader() {
+            const uint8_t type = PeekByte();
+            size_t size;
+            if ((type & 0xf0) == msgpack::FIXARRAY) {
+                ++myPosition;
+                size = type & 0x0f;
+            } else if (type == msgpack::ARRAY16) {
+                ++myPosition;
+                size = util::LoadBigEndian16(ReadBytes(2));
+            } else if (type == msgpack::ARRAY32) {
+                ++myPosition;
+                size = util::LoadBigEndian32(ReadBytes(4));
+            } else {
+                throw InvalidRequestFault();
+            }
+            return size;
+        }
+
+        // A response map starting at the current position
+        Response ReadResponse() {
+            const size_t size = ReadMapHeader();
+
+            bool hasVersion = false;
+            bool hasId = false;
+            bool hasResult = false;
+            bool hasError = false;
+            Value id;
+            Value result;
+            int32_t code = 0;
+            std::string message;
+
+            for (size_t i = 0; i < size; ++i) {
+                switch (ReadKey()) {
+                case Member::JSONRPC:
+                    if (!hasVersion) {
+                        ValidateJsonrpcVersion();
+                        hasVersion = true;
+                        continue;
+                    }
+                    break;
+                case Member::ID:
+                    if (!hasId) {
+                        id = ReadId();
+                        hasId = true;
+                        continue;
+                    }
+                    break;
+                case Member::RESULT:
+                    if (!hasResult) {
+                        result = ReadValue(0);
+                        hasResult = true;
+                        continue;
+                    }
+                    break;
+                case Member::FAULT:
+                    if (!hasError) {
+                        ReadError(code, message);
+                        hasError = true;
+                        continue;
+                    }
+                    break;
+                default:
+                    break;
+                }
+                ReadValue(0);
+            }
+
+            if (!hasVersion || !hasId || hasResult == hasError) {
+                throw InvalidRequestFault();
+            }
+
+            if (hasResult) {
+                return Response(std::move(result), std::move(id));
+            }
+            return Response(code, std::move(message), std::move(id));
+        }
+
+        Request::Parameters ReadParameters() {
+            const size_t size = CheckCount(ReadArrayHeader(), 1);
+            Request::Parameters parameters;
+            for (size_t i = 0; i < size; ++i) {
+                parameters.emplace_back(ReadValue(1));
+            }
+            return parameters;
+        }
+
+        // The method name, or the id standing in for it, see
+        // Dispatcher::EnableMethodIds
+        void ReadMethod(std::string& name, int32_t& methodId) {
+            size_t size;
+            if (ReadStringHeader(size)) {
+                name.assign(ReadBytes(size), size);
+                return;
+            }
+
+            int64_t integer;
+            double number;
+            if (ReadNumber(integer, number) != Value::Type::INTEGER_64
+                || integer < 0 || integer > std::numeric_limits<int32_t>::max()) {
+                throw InvalidRequestFault();
+            }
+            methodId = static_cast<int32_t>(integer);
+        }
+
+        Value ReadId() {
+            const uint8_t type = PeekByte();
+            if (type == msgpack::NIL) {
+                ++myPosition;
+                return{};
+            }
+            size_t size;
+            if (ReadStringHeader(size)) {
+                return Value(std::string(ReadBytes(size), size));
+            }
+
+            int64_t integer;
+            double number;
+            if (ReadNumber(integer, number) != Value::Type::INTEGER_64) {
+                throw InvalidRequestFault();
+            }
+            return GetInteger(integer);
+        }
+
+        void ReadError(int32_t& code, std::string& message) {
+            const size_t size = ReadMapHeader();
+            bool hasCode = false;
+            bool hasMessage = false;
+            for (size_t i = 0; i < size; ++i) {
+                size_t length;
+                if (ReadStringHeader(length)) {
+                    const std::string key(ReadBytes(length), length);
+                    if (key == json::ERROR_CODE_NAME && !hasCode) {
+                        int64_t integer;
+                        double number;
+                        if (ReadNumber(integer, number) != Value::Type::INTEGER_64
+                            || integer < std::numeric_limits<int32_t>::min()
+                            || integer > std::numeric_limits<int32_t>::max()) {
+                            throw InvalidRequestFault();
+                        }
+                        code = static_cast<int32_t>(integer);
+                        hasCode = true;
+                        continue;
+                    } else if (key == json::ERROR_MESSAGE_NAME && !hasMessage) {
+                        message = ReadString();
+                        hasMessage = true;
+                        continue;
+                    }
+                } else {
+                    ReadValue(0);
+                }
+                ReadValue(0);
+            }
+            if (!hasCode || !hasMessage) {
+                throw InvalidRequestFault();
+            }
+        }
+
+        static Value GetInteger(int64_t value) {
+            if (value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max()) {
+                return Value(static_cast<int32_t>(value));
+            }
+            return Value(value);
+        }
+
+        // Consumes a number, returning INTEGER_64 with integer set, DOUBLE
+        // with number set, or NIL without consuming anything if the next
+        // value is not a number. uint64 values above the int64_t range are
+        // doubles, as with the JSON readers.
+        Value::Type ReadNumber(int64_t& integer, double& number) {
+            const uint8_t type = PeekByte();
+            if (type <= msgpack::POSITIVE_FIXINT_MAX || type >= msgpack::NEGATIVE_FIXINT_MIN) {
+                ++myPosition;
+                integer = static_cast<int8_t>(type);
+                return Value::Type::INTEGER_64;
+            }
+
+            switch (type) {
+            case msgpack::UINT8:
+                ++myPosition;
+                integer = ReadByte();
+                return Value::Type::INTEGER_64;
+            case msgpack::UINT16:
+                ++myPosition;
+                integer = util::LoadBigEndian16(ReadBytes(2));
+                return Value::Type::INTEGER_64;
+            case msgpack::UINT32:
+                ++myPosition;
+                integer = util::LoadBigEndian32(ReadBytes(4));
+                return Value::Type::INTEGER_64;
+            case msgpack::UINT64: {
+                ++myPosition;
+                const uint64_t value = util::LoadBigEndian64(ReadBytes(8));
+                if (value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                    number = static_cast<double>(value);
+                    return Value::Type::DOUBLE;
+                }
+                integer = static_cast<int64_t>(value);
+                return Value::Type::INTEGER_64;
+            }
+            case msgpack::INT8:
+                ++myPosition;
+                integer = static_cast<int8_t>(ReadByte());
+                return Value::Type::INTEGER_64;
+            case msgpack::INT16:
+                ++myPosition;
+                integer = static_cast<int16_t>(util::LoadBigEndian16(ReadBytes(2)));
+                return Value::Type::INTEGER_64;
+            case msgpack::INT32:
+                ++myPosition;
+                integer = static_cast<int32_t>(util::LoadBigEndian32(ReadBytes(4)));
+                return Value::Type::INTEGER_64;
+            case msgpack::INT64:
+                ++myPosition;
+                integer = static_cast<int64_t>(util::LoadBigEndian64(ReadBytes(8)));
+                return Value::Type::INTEGER_64;
+            case msgpack::FLOAT32: {
+                ++myPosition;
+                const uint32_t bits = util::LoadBigEndian32(ReadBytes(4));
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                number = value;
+                return Value::Type::DOUBLE;
+            }
+            case msgpack::FLOAT64: {
+                ++myPosition;
+                const uint64_t bits = util::LoadBigEndian64(ReadBytes(8));
+                memcpy(&number, &bits, sizeof(number));
+                return Value::Type::DOUBLE;
+            }
+            default:
+                return Value::Type::NIL;
+            }
+        }
+
+        Value ReadValue(size_t depth) {
+            if (depth > MAX_DEPTH) {
+                ThrowParseError("nesting too deep");
+            }
+
+            int64_t integer;
+            double number;
+            switch (ReadNumber(integer, number)) {
+            case Value::Type::INTEGER_64:
+                return GetInteger(integer);
+            case Value::Type::DOUBLE:
+                return Value(number);
+            default:
+                break;
+            }
+
+            size_t size;
+            if (ReadStringHeader(size)) {
+                return Value(std::string(ReadBytes(size), size));
+            }
+
+            const uint8_t type = ReadByte();
+            if ((type & 0xf0) == msgpack::FIXMAP) {
+                return ReadStruct(type & 0x0f, depth);
+            } else if ((type & 0xf0) == msgpack::FIXARRAY) {
+                return ReadArray(type & 0x0f, depth);
+            }
+
+            switch (type) {
+            case msgpack::NIL:
+                return Value();
+            case msgpack::BOOL_FALSE:
+                return Value(false);
+            case msgpack::BOOL_TRUE:
+                return Value(true);
+            case msgpack::BIN8:
+                size = ReadByte();
+                return Value(std::string(ReadBytes(size), size), true);
+            case msgpack::BIN16:
+                size = util::LoadBigEndian16(ReadBytes(2));
+                return Value(std::string(ReadBytes(size), size), true);
+            case msgpack::BIN32:
+                size = util::LoadBigEndian32(ReadBytes(4));
+                return Value(std::string(ReadBytes(size), size), true);
+            case msgpack::ARRAY16:
+                return ReadArray(util::LoadBigEndian16(ReadBytes(2)), depth);
+            case msgpack::ARRAY32:
+                return ReadArray(util::LoadBigEndian32(ReadBytes(4)), depth);
+            case msgpack::MAP16:
+                return ReadStruct(util::LoadBigEndian16(ReadBytes(2)), depth);
+            case msgpack::MAP32:
+                return ReadStruct(util::LoadBigEndian32(ReadBytes(4)), depth);
+            default:
+                break;
+            }
+
+            ThrowParseError("unsupported MessagePack type");
+            return{};
+        }
+
+        Value ReadStruct(size_t size, size_t depth) {
+            CheckCount(size, 2);
+            Value::Struct data;
+            for (size_t i = 0; i < size; ++i) {
+                size_t length;
+                if (!ReadStringHeader(length)) {
+                    ThrowParseError("map key is not a string");
+                }
+                std::string name(ReadBytes(length), length);
+                data.emplace(std::move(name), ReadValue(depth + 1));
+            }
+            return Value(std::move(data));
+        }
+
+        // Non-empty arrays holding only numbers are stored contiguously, see
+        // JsonReader. They are classified in a first pass over the numbers,
+        // which stops at the first element that is not one.
+        Value ReadArray(size_t size, size_t depth) {
+            CheckCount(size, 1);
+            const char* const start = myPosition;
+
+            auto type = size == 0 ? Value::Type::ARRAY : Value::Type::INTEGER_32_ARRAY;
+            for (size_t i = 0; i < size && type != Value::Type::ARRAY; ++i) {
+                int64_t integer;
+                double number;
+                switch (ReadNumber(integer, number)) {
+                case Value::Type::INTEGER_64:
+                    if (type == Value::Type::INTEGER_32_ARRAY
+                        && (integer < std::numeric_limits<int32_t>::min() || integer > std::numeric_limits<int32_t>::max())) {
+                        type = Value::Type::INTEGER_64_ARRAY;
+                    }
+                    break;
+                case Value::Type::DOUBLE:
+                    type = Value::Type::DOUBLE_ARRAY;
+                    break;
+                default:
+                    type = Value::Type::ARRAY;
+                    break;
+                }
+            }
+            myPosition = start;
+
+            int64_t integer;
+            double number;
+            switch (type) {
+            case Value::Type::INTEGER_32_ARRAY: {
+                Value::Integer32Array values;
+                values.reserve(size);
+                for (size_t i = 0; i < size; ++i) {
+                    ReadNumber(integer, number);
+                    values.push_back(static_cast<int32_t>(integer));
+                }
+                return Value(std::move(values));
+            }
+            case Value::Type::INTEGER_64_ARRAY: {
+                Value::Integer64Array values;
+                values.reserve(size);
+                for (size_t i = 0; i < size; ++i) {
+                    ReadNumber(integer, number);
+                    values.push_back(integer);
+                }
+                return Value(std::move(values));
+            }
+            case Value::Type::DOUBLE_ARRAY: {
+                Value::DoubleArray values;
+                values.reserve(size);
+                for (size_t i = 0; i < size; ++i) {
+                    values.push_back(ReadNumber(integer, number) == Value::Type::DOUBLE
+                        ? number : static_cast<double>(integer));
+                }
+                return Value(std::move(values));
+            }
+            default: {
+                Value::Array values;
+                values.reserve(size);
+                for (size_t i = 0; i < size; ++i) {
+                    values.emplace_back(ReadValue(depth + 1));
+                }
+                return Value(std::move(values));
+            }
+            }
+        }
+
+        const char* myBegin;
+        const char* myEnd;
+        const char* myPosition;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_MSGPACKREADER_H
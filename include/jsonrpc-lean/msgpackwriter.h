@@ -0,0 +1,432 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_MSGPACKWRITER_H
+#define JSONRPC_LEAN_MSGPACKWRITER_H
+
+#include "writer.h"
+#include "fault.h"
+#include "json.h"
+#include "msgpack.h"
+#include "util.h"
+#include "binaryformatteddata.h"
+#include "value.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace jsonrpc {
+
+    // Writes the JSON-RPC envelope as a MessagePack map with the same keys
+    // JsonWriter uses. BINARY values become bin, not base64 strings.
+    class MsgPackWriter final : public Writer {
+    public:
+        MsgPackWriter() : myRequestData(new BinaryFormattedData()), myBuffer(myRequestData->GetBuffer()) {
+            myContainers.reserve(16);
+        }
+
+        // Writes into a transport supplied buffer, see BinaryFormattedData
+        explicit MsgPackWriter(std::string buffer)
+            : myRequestData(new BinaryFormattedData(std::move(buffer))),
+            myBuffer(myRequestData->GetBuffer()) {
+            myContainers.reserve(16);
+        }
+
+        // Writer
+        std::shared_ptr<FormattedData> GetData() override {
+            return std::static_pointer_cast<FormattedData>(myRequestData);
+        }
+
+        void StartDocument() override {
+            // Empty
+        }
+
+        void EndDocument() override {
+            // Empty
+        }
+
+        void StartRequest(const std::string& methodName, const Value& id) override {
+            AddElement();
+            WriteHeader(msgpack::FIXMAP, msgpack::MAP16, HasId(id) ? 4 : 3);
+
+            WriteVersion();
+
+            WriteString(json::METHOD_NAME, sizeof(json::METHOD_NAME) - 1);
+            WriteString(methodName.data(), methodName.size());
+
+            WriteId(id);
+
+            WriteString(json::PARAMS_NAME, sizeof(json::PARAMS_NAME) - 1);
+            StartContainer(msgpack::FIXARRAY);
+        }
+
+        void StartRequestById(int32_t methodId, const Value& id) override {
+            AddElement();
+            WriteHeader(msgpack::FIXMAP, msgpack::MAP16, HasId(id) ? 4 : 3);
+
+            WriteVersion();
+
+            WriteString(json::METHOD_NAME, sizeof(json::METHOD_NAME) - 1);
+            WriteInteger(methodId);
+
+            WriteId(id);
+
+            WriteString(json::PARAMS_NAME, sizeof(json::PARAMS_NAME) - 1);
+            StartContainer(msgpack::FIXARRAY);
+        }
+
+        void EndRequest() override {
+            EndContainer();
+        }
+
+        void StartParameter() override {
+            // Empty
+        }
+
+        void EndParameter() override {
+            // Empty
+        }
+
+        void StartResponse(const Value& id) override {
+            WriteHeader(msgpack::FIXMAP, msgpack::MAP16, HasId(id) ? 3 : 2);
+
+            WriteVersion();
+
+            WriteId(id);
+
+            WriteString(json::RESULT_NAME, sizeof(json::RESULT_NAME) - 1);
+        }
+
+        void EndResponse() override {
+            // Empty
+        }
+
+        void StartFaultResponse(const Value& id) override {
+            WriteHeader(msgpack::FIXMAP, msgpack::MAP16, HasId(id) ? 3 : 2);
+
+            WriteVersion();
+
+            WriteId(id);
+        }
+
+        void EndFaultResponse() override {
+            // Empty
+        }
+
+        void WriteFault(int32_t code, const std::string& string) override {
+            WriteString(json::ERROR_NAME, sizeof(json::ERROR_NAME) - 1);
+            WriteHeader(msgpack::FIXMAP, msgpack::MAP16, 2);
+
+            WriteString(json::ERROR_CODE_NAME, sizeof(json::ERROR_CODE_NAME) - 1);
+            WriteInteger(code);
+
+            WriteString(json::ERROR_MESSAGE_NAME, sizeof(json::ERROR_MESSAGE_NAME) - 1);
+            WriteString(string.data(), string.size());
+        }
+
+        void StartArray() override {
+            AddElement();
+            StartContainer(msgpack::FIXARRAY);
+        }
+
+        void StartSizedArray(size_t size) override {
+            AddElement();
+            WriteHeader(msgpack::FIXARRAY, msgpack::ARRAY16, size);
+            myContainers.push_back(Container{ 0, 0, 0 });
+        }
+
+        void EndArray() override {
+            EndContainer();
+        }
+
+        void StartStruct() override {
+            AddElement();
+            StartContainer(msgpack::FIXMAP);
+        }
+
+        void StartSizedStruct(size_t size) override {
+            AddElement();
+            WriteHeader(msgpack::FIXMAP, msgpack::MAP16, size);
+            myContainers.push_back(Container{ 0, 0, 0 });
+        }
+
+        void EndStruct() override {
+            EndContainer();
+        }
+
+        void StartStructElement(const std::string& name) override {
+            // Only the member value counts towards the map's size
+            WriteString(name.data(), name.size());
+        }
+
+        void EndStructElement() override {
+            // Empty
+        }
+
+        void WriteBinary(const char* data, size_t size) override {
+            AddElement();
+            char* out = myBuffer.Push(5);
+            if (size <= 0xff) {
+                *out++ = static_cast<char>(msgpack::BIN8);
+                *out++ = static_cast<char>(size);
+            } else if (size <= 0xffff) {
+                *out++ = static_cast<char>(msgpack::BIN16);
+                out = util::StoreBigEndian(out, static_cast<uint16_t>(size));
+            } else {
+                CheckLength(size);
+                *out++ = static_cast<char>(msgpack::BIN32);
+                out = util::StoreBigEndian(out, static_cast<uint32_t>(size));
+            }
+            myBuffer.Pop(myBuffer.GetData() + myBuffer.GetSize() - out);
+            myBuffer.Append(data, size);
+        }
+
+        void WriteNull() override {
+            AddElement();
+            myBuffer.Put(static_cast<char>(msgpack::NIL));
+        }
+
+        void Write(bool value) override {
+            AddElement();
+            myBuffer.Put(static_cast<char>(value ? msgpack::BOOL_TRUE : msgpack::BOOL_FALSE));
+        }
+
+        void Write(double value) override {
+            AddElement();
+            EncodeDouble(value, myBuffer.Push(9));
+        }
+
+        void Write(int32_t value) override {
+            AddElement();
+            WriteInteger(value);
+        }
+
+        void Write(int64_t value) override {
+            AddElement();
+            WriteInteger(value);
+        }
+
+        void Write(const std::string& value) override {
+            AddElement();
+            WriteString(value.data(), value.size());
+        }
+
+        // The element count is known up front, so these are written without
+        // going through the container stack
+        void WriteArray(const int32_t* values, size_t size) override {
+            WriteNumberArray(values, size, 5, [](int32_t value, char* out) {
+                return EncodeInteger(value, out);
+            });
+        }
+
+        void WriteArray(const int64_t* values, size_t size) override {
+            WriteNumberArray(values, size, 9, [](int64_t value, char* out) {
+                return EncodeInteger(value, out);
+            });
+        }
+
+        void WriteArray(const double* values, size_t size) override {
+            WriteNumberArray(values, size, 9, [](double value, char* out) {
+                return EncodeDouble(value, out);
+            });
+        }
+
+    private:
+        // The most any single write reserves in the buffer up front
+        static const size_t MAX_RESERVE = 8 * 1024;
+
+        // Containers whose body is at most this long are moved down to a
+        // shorter header once their size is known, longer ones keep the
+        // placeholder's 32-bit one rather than being copied
+        static const size_t MAX_COMPACTION = 4 * 1024;
+
+        // FixType is 0 for containers whose header is already written
+        struct Container {
+            size_t Offset;
+            size_t Size;
+            uint8_t FixType;
+        };
+
+        static void CheckLength(size_t size) {
+            if (size > 0xffffffff) {
+                throw InternalErrorFault("Value too large for MessagePack");
+            }
+        }
+
+        // Smallest encoding that holds value, at most 9 bytes
+        static char* EncodeInteger(int64_t value, char* out) {
+            if (value >= 0) {
+                if (value <= msgpack::POSITIVE_FIXINT_MAX) {
+                    *out++ = static_cast<char>(value);
+                } else if (value <= 0xff) {
+                    *out++ = static_cast<char>(msgpack::UINT8);
+                    *out++ = static_cast<char>(value);
+                } else if (value <= 0xffff) {
+                    *out++ = static_cast<char>(msgpack::UINT16);
+                    out = util::StoreBigEndian(out, static_cast<uint16_t>(value));
+                } else if (value <= 0xffffffff) {
+                    *out++ = static_cast<char>(msgpack::UINT32);
+                    out = util::StoreBigEndian(out, static_cast<uint32_t>(value));
+                } else {
+                    *out++ = static_cast<char>(msgpack::UINT64);
+                    out = util::StoreBigEndian(out, static_cast<uint64_t>(value));
+                }
+            } else if (value >= -32) {
+                *out++ = static_cast<char>(value);
+            } else if (value >= INT8_MIN) {
+                *out++ = static_cast<char>(msgpack::INT8);
+                *out++ = static_cast<char>(value);
+            } else if (value >= INT16_MIN) {
+                *out++ = static_cast<char>(msgpack::INT16);
+                out = util::StoreBigEndian(out, static_cast<uint16_t>(value));
+            } else if (value >= INT32_MIN) {
+                *out++ = static_cast<char>(msgpack::INT32);
+                out = util::StoreBigEndian(out, static_cast<uint32_t>(value));
+            } else {
+                *out++ = static_cast<char>(msgpack::INT64);
+                out = util::StoreBigEndian(out, static_cast<uint64_t>(value));
+            }
+            return out;
+        }
+
+        static char* EncodeDouble(double value, char* out) {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            *out++ = static_cast<char>(msgpack::FLOAT64);
+            return util::StoreBigEndian(out, bits);
+        }
+
+        void WriteInteger(int64_t value) {
+            char* const out = myBuffer.Push(9);
+            myBuffer.Pop(out + 9 - EncodeInteger(value, out));
+        }
+
+        void WriteString(const char* data, size_t size) {
+            char* out = myBuffer.Push(5);
+            if (size <= msgpack::FIXSTR_MAX) {
+                *out++ = static_cast<char>(msgpack::FIXSTR | size);
+            } else if (size <= 0xff) {
+                *out++ = static_cast<char>(msgpack::STR8);
+                *out++ = static_cast<char>(size);
+            } else if (size <= 0xffff) {
+                *out++ = static_cast<char>(msgpack::STR16);
+                out = util::StoreBigEndian(out, static_cast<uint16_t>(size));
+            } else {
+                CheckLength(size);
+                *out++ = static_cast<char>(msgpack::STR32);
+                out = util::StoreBigEndian(out, static_cast<uint32_t>(size));
+            }
+            myBuffer.Pop(myBuffer.GetData() + myBuffer.GetSize() - out);
+            myBuffer.Append(data, size);
+        }
+
+        // An array or map header, fixType being FIXARRAY or FIXMAP and
+        // type16 the matching ARRAY16 or MAP16; 32-bit sizes follow it
+        void WriteHeader(uint8_t fixType, uint8_t type16, size_t size) {
+            char* out = myBuffer.Push(5);
+            if (size <= msgpack::FIXARRAY_MAX) {
+                *out++ = static_cast<char>(fixType | size);
+            } else if (size <= 0xffff) {
+                *out++ = static_cast<char>(type16);
+                out = util::StoreBigEndian(out, static_cast<uint16_t>(size));
+            } else {
+                CheckLength(size);
+                *out++ = static_cast<char>(type16 + 1);
+                out = util::StoreBigEndian(out, static_cast<uint32_t>(size));
+            }
+            myBuffer.Pop(myBuffer.GetData() + myBuffer.GetSize() - out);
+        }
+
+        void WriteVersion() {
+            WriteString(json::JSONRPC_NAME, sizeof(json::JSONRPC_NAME) - 1);
+            WriteString(json::JSONRPC_VERSION_2_0, sizeof(json::JSONRPC_VERSION_2_0) - 1);
+        }
+
+        static bool HasId(const Value& id) {
+            return id.IsString() || id.IsInteger32() || id.IsInteger64() || id.IsNil();
+        }
+
+        void WriteId(const Value& id) {
+            if (HasId(id)) {
+                WriteString(json::ID_NAME, sizeof(json::ID_NAME) - 1);
+                if (id.IsString()) {
+                    WriteString(id.AsString().data(), id.AsString().size());
+                } else if (id.IsInteger32() || id.IsInteger64()) {
+                    WriteInteger(id.AsInteger64());
+                } else {
+                    myBuffer.Put(static_cast<char>(msgpack::NIL));
+                }
+            }
+        }
+
+        // Counts a value towards the enclosing array or map
+        void AddElement() {
+            if (!myContainers.empty()) {
+                ++myContainers.back().Size;
+            }
+        }
+
+        // Without a size hint the size is not known until the container
+        // ends, so a 32-bit header is left as a placeholder and patched then
+        void StartContainer(uint8_t fixType) {
+            myContainers.push_back(Container{ myBuffer.GetSize(), 0, fixType });
+            myBuffer.Push(5);
+        }
+
+        void EndContainer() {
+            const Container container = myContainers.back();
+            myContainers.pop_back();
+            if (container.FixType == 0) {
+                return;
+            }
+            CheckLength(container.Size);
+
+            char* const header = myBuffer.GetData() + container.Offset;
+            const size_t body = myBuffer.GetSize() - container.Offset - 5;
+            const uint8_t type16 = container.FixType == msgpack::FIXARRAY ? msgpack::ARRAY16 : msgpack::MAP16;
+            if (body <= MAX_COMPACTION && container.Size <= 0xffff) {
+                if (container.Size <= msgpack::FIXARRAY_MAX) {
+                    header[0] = static_cast<char>(container.FixType | container.Size);
+                    memmove(header + 1, header + 5, body);
+                    myBuffer.Pop(4);
+                } else {
+                    header[0] = static_cast<char>(type16);
+                    util::StoreBigEndian(header + 1, static_cast<uint16_t>(container.Size));
+                    memmove(header + 3, header + 5, body);
+                    myBuffer.Pop(2);
+                }
+                return;
+            }
+            header[0] = static_cast<char>(type16 + 1);
+            util::StoreBigEndian(header + 1, static_cast<uint32_t>(container.Size));
+        }
+
+        template<typename T, typename EncodeFn>
+        void WriteNumberArray(const T* values, size_t size, size_t maxLength, EncodeFn encode) {
+            AddElement();
+            WriteHeader(msgpack::FIXARRAY, msgpack::ARRAY16, size);
+
+            const size_t blockSize = MAX_RESERVE / maxLength;
+            for (size_t block = 0; block < size; block += blockSize) {
+                const size_t count = size - block < blockSize ? size - block : blockSize;
+                char* const begin = myBuffer.Push(count * maxLength);
+                char* out = begin;
+                for (size_t i = block; i < block + count; ++i) {
+                    out = encode(values[i], out);
+                }
+                myBuffer.Pop(begin + count * maxLength - out);
+            }
+        }
+
+        std::shared_ptr<BinaryFormattedData> myRequestData;
+        OutputBuffer& myBuffer;
+        std::vector<Container> myContainers;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_MSGPACKWRITER_H
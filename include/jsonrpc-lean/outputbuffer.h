@@ -0,0 +1,118 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_OUTPUTBUFFER_H
+#define JSONRPC_LEAN_OUTPUTBUFFER_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace jsonrpc {
+
+    // An output stream in the shape rapidjson expects (Put/Flush plus the
+    // PutReserve/PutUnsafe overloads below) that writes into a std::string.
+    // The string is sized ahead of what has been written and trimmed when it
+    // is released, so Release() hands the bytes over without a copy, and a
+    // released string can be passed back in to reuse its capacity.
+    class OutputBuffer {
+    public:
+        typedef char Ch;
+
+        OutputBuffer() : myLength(0) {}
+
+        // Reuses the capacity of buffer, its contents are discarded
+        explicit OutputBuffer(std::string buffer) : myData(std::move(buffer)), myLength(0) {
+            myData.resize(myData.capacity());
+        }
+
+        OutputBuffer(const OutputBuffer&) = delete;
+        OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+        void Put(Ch c) {
+            if (myLength == myData.size()) {
+                Grow(1);
+            }
+            myData[myLength++] = c;
+        }
+
+        void PutUnsafe(Ch c) {
+            myData[myLength++] = c;
+        }
+
+        void Flush() {}
+
+        // Makes room for count more characters
+        void Reserve(size_t count) {
+            if (myData.size() - myLength < count) {
+                Grow(count);
+            }
+        }
+
+        // Appends count uninitialized characters and returns a pointer to them
+        Ch* Push(size_t count) {
+            Reserve(count);
+            Ch* const begin = &myData[myLength];
+            myLength += count;
+            return begin;
+        }
+
+        void Pop(size_t count) {
+            myLength -= count;
+        }
+
+        void Append(const Ch* data, size_t size) {
+            if (size != 0) {
+                memcpy(Push(size), data, size);
+            }
+        }
+
+        const Ch* GetString() {
+            Reserve(1);
+            myData[myLength] = '\0';
+            return myData.data();
+        }
+
+        size_t GetSize() const { return myLength; }
+
+        // The written characters, for patching them in place
+        Ch* GetData() { return &myData[0]; }
+
+        void Clear() { myLength = 0; }
+
+        // Moves the written characters out, leaving the buffer empty
+        std::string Release() {
+            myData.resize(myLength);
+            myLength = 0;
+            return std::move(myData);
+        }
+
+    private:
+        void Grow(size_t count) {
+            const size_t required = myLength + count;
+            size_t size = myData.size() < 256 ? 256 : myData.size() + myData.size() / 2;
+            if (size < required) {
+                size = required;
+            }
+            myData.resize(size);
+        }
+
+        std::string myData;
+        size_t myLength;
+    };
+
+    // Picked up by rapidjson through argument dependent lookup in preference
+    // to its generic versions, which reserve nothing and always check
+    inline void PutReserve(OutputBuffer& stream, size_t count) {
+        stream.Reserve(count);
+    }
+
+    inline void PutUnsafe(OutputBuffer& stream, OutputBuffer::Ch c) {
+        stream.PutUnsafe(c);
+    }
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_OUTPUTBUFFER_H
@@ -0,0 +1,36 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_RAWJSON_H
+#define JSONRPC_LEAN_RAWJSON_H
+
+#include <memory>
+#include <string>
+
+namespace jsonrpc {
+
+    // Already serialized JSON, e.g. a cached result, that JsonWriter emits
+    // verbatim. It is neither parsed nor validated, so it must hold exactly
+    // one well-formed JSON value. The text is shared between copies.
+    class RawJson {
+    public:
+        explicit RawJson(std::string json)
+            : myJson(std::make_shared<const std::string>(std::move(json))) {
+        }
+
+        explicit RawJson(std::shared_ptr<const std::string> json)
+            : myJson(json ? std::move(json) : std::make_shared<const std::string>("null")) {
+        }
+
+        const std::string& GetJson() const { return *myJson; }
+        const std::shared_ptr<const std::string>& GetSharedJson() const { return myJson; }
+
+    private:
+        std::shared_ptr<const std::string> myJson;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_RAWJSON_H
@@ -7,9 +7,13 @@
 #ifndef JSONRPC_LEAN_READER_H
 #define JSONRPC_LEAN_READER_H
 
+#include "fault.h"
+#include "request.h"
+
+#include <vector>
+
 namespace jsonrpc {
 
-    class Request;
     class Response;
     class Value;
 
@@ -20,6 +24,23 @@ namespace jsonrpc {
         virtual Request GetRequest() = 0;
         virtual Response GetResponse() = 0;
         virtual Value GetValue() = 0;
+
+        // A batch request holds GetBatchSize() requests, read one at a time
+        // with GetBatchRequest so that an invalid one fails on its own
+        virtual bool IsBatch() { return false; }
+
+        virtual size_t GetBatchSize() {
+            throw InternalErrorFault("Batches are not supported by this format");
+        }
+
+        virtual Request GetBatchRequest(size_t) {
+            throw InternalErrorFault("Batches are not supported by this format");
+        }
+
+        // The responses in a batch response, in the order they were sent
+        virtual std::vector<Response> GetBatchResponse() {
+            throw InternalErrorFault("Batches are not supported by this format");
+        }
     };
 
 } // namespace jsonrpc
@@ -27,17 +27,45 @@ namespace jsonrpc {
             // Empty
         }
 
+        // A request naming its method by the id the server's Dispatcher
+        // assigned to it, see Dispatcher::EnableMethodIds
+        Request(int32_t methodId, Parameters parameters, Value id)
+            : myMethodId(methodId),
+            myParameters(std::move(parameters)),
+            myId(std::move(id)) {
+            // Empty
+        }
+
         const std::string& GetMethodName() const { return myMethodName; }
+        bool HasMethodId() const { return myMethodId >= 0; }
+        int32_t GetMethodId() const { return myMethodId; }
         const Parameters& GetParameters() const { return myParameters; }
         const Value& GetId() const { return myId; }
 
-        void Write(Writer& writer) const {
-            Write(myMethodName, myParameters, myId, writer);
+        template<typename WriterType>
+        void Write(WriterType& writer) const {
+            if (HasMethodId()) {
+                Write(myMethodId, myParameters, myId, writer);
+            } else {
+                Write(myMethodName, myParameters, myId, writer);
+            }
+        }
+
+        template<typename WriterType>
+        static void Write(const std::string& methodName, const Parameters& params, const Value& id, WriterType& writer) {
+            WriteInternal(methodName, params, id, writer);
+        }
+
+        template<typename WriterType>
+        static void Write(int32_t methodId, const Parameters& params, const Value& id, WriterType& writer) {
+            WriteInternal(methodId, params, id, writer);
         }
 
-        static void Write(const std::string& methodName, const Parameters& params, const Value& id, Writer& writer) {
+    private:
+        template<typename MethodType, typename WriterType>
+        static void WriteInternal(const MethodType& method, const Parameters& params, const Value& id, WriterType& writer) {
             writer.StartDocument();
-            writer.StartRequest(methodName, id);
+            StartRequestInternal(method, id, writer);
             for (auto& param : params) {
                 writer.StartParameter();
                 param.Write(writer);
@@ -47,8 +75,18 @@ namespace jsonrpc {
             writer.EndDocument();
         }
 
-    private:
+        template<typename WriterType>
+        static void StartRequestInternal(const std::string& methodName, const Value& id, WriterType& writer) {
+            writer.StartRequest(methodName, id);
+        }
+
+        template<typename WriterType>
+        static void StartRequestInternal(int32_t methodId, const Value& id, WriterType& writer) {
+            writer.StartRequestById(methodId, id);
+        }
+
         std::string myMethodName;
+        int32_t myMethodId = -1;
         Parameters myParameters;
         Value myId;
     };
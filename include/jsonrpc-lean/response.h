@@ -27,7 +27,8 @@ namespace jsonrpc {
             myId(std::move(id)) {
         }
 
-        void Write(Writer& writer) const {
+        template<typename WriterType>
+        void Write(WriterType& writer) const {
             writer.StartDocument();
             if (myIsFault) {
                 writer.StartFaultResponse(myId);
@@ -21,6 +21,7 @@
 
 
 #include <string>
+#include <vector>
 
 namespace jsonrpc {
 
@@ -43,6 +44,7 @@ namespace jsonrpc {
         // aContentType is here to allow future implementation of other rpc formats with minimal code changes
         // Will return NULL if no FormatHandler is found, otherwise will return a FormatedData
         // If aRequestData is a Notification (the client doesn't expect a response), the returned FormattedData will have an empty ->GetData() buffer and ->GetSize() will be 0
+        // A batch is answered with a batch of the responses to its calls, or with nothing if it only holds notifications
         std::shared_ptr<jsonrpc::FormattedData> HandleRequest(const std::string& aRequestData, const std::string& aContentType = "application/json") {
 
             // first find the correct handler
@@ -58,25 +60,53 @@ namespace jsonrpc {
                 return nullptr;
             }
             
-            auto writer = fmtHandler->CreateWriter();
-
             try {
                 auto reader = fmtHandler->CreateReader(aRequestData);
+                if (reader->IsBatch()) {
+                    return HandleBatch(*fmtHandler, *reader);
+                }
                 Request request = reader->GetRequest();
                 reader.reset();
 
-                auto response = myDispatcher.Invoke(request.GetMethodName(), request.GetParameters(), request.GetId());
-                if (!response.GetId().IsBoolean() || response.GetId().AsBoolean() != false) {
+                auto response = myDispatcher.Invoke(request);
+                if (response.GetId().IsBoolean() && response.GetId().AsBoolean() == false) {
                     // if Id is false, this is a notification and we don't have to write a response
-                    response.Write(*writer);
+                    return fmtHandler->CreateWriter()->GetData();
                 }
+                return fmtHandler->FormatResponse(response);
             } catch (const Fault& ex) {
-                Response(ex.GetCode(), ex.GetString(), Value()).Write(*writer);
+                return fmtHandler->FormatResponse(Response(ex.GetCode(), ex.GetString(), Value()));
             }
-
-            return writer->GetData();
         }
     private:
+        // Each request fails on its own, an invalid one is answered with a
+        // fault with a null id. An empty batch is itself an invalid request.
+        std::shared_ptr<FormattedData> HandleBatch(FormatHandler& fmtHandler, Reader& reader) {
+            const size_t size = reader.GetBatchSize();
+            if (size == 0) {
+                throw InvalidRequestFault();
+            }
+
+            std::vector<Response> responses;
+            responses.reserve(size);
+            for (size_t i = 0; i < size; ++i) {
+                try {
+                    Request request = reader.GetBatchRequest(i);
+                    auto response = myDispatcher.Invoke(request);
+                    if (!(response.GetId().IsBoolean() && response.GetId().AsBoolean() == false)) {
+                        responses.emplace_back(std::move(response));
+                    }
+                } catch (const Fault& ex) {
+                    responses.emplace_back(ex.GetCode(), ex.GetString(), Value());
+                }
+            }
+
+            if (responses.empty()) {
+                return fmtHandler.CreateWriter()->GetData();
+            }
+            return fmtHandler.FormatBatchResponse(responses);
+        }
+
         Dispatcher myDispatcher;
         std::vector<FormatHandler*> myFormatHandlers;
     };
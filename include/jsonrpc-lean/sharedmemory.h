@@ -0,0 +1,391 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_SHAREDMEMORY_H
+#define JSONRPC_LEAN_SHAREDMEMORY_H
+
+#ifdef __linux__
+
+#include "connectionpool.h"
+#include "formatteddata.h"
+#include "server.h"
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+
+namespace jsonrpc {
+
+    struct SharedMemoryOptions {
+        // How many times a side waiting for the other checks again before
+        // it sleeps on a futex. 0 sleeps at once; a large number busy-polls
+        // for the lowest latency, at the cost of a core per waiting side.
+        size_t SpinCount = 0;
+        // Receive refuses larger messages, as their size comes from the
+        // other process, and closes the channel
+        size_t MaxMessageSize = 16 * 1024 * 1024;
+    };
+
+    // A client and a server on the same host talking through two byte rings
+    // in shared memory, one for requests and one for responses. Messages
+    // are copied from the FormattedData segments straight into the ring and
+    // out of it into a reused string, and may be larger than the ring: the
+    // writer then waits for the reader to make room.
+    //
+    // Each ring has one writing and one reading process. Threads of a
+    // process may share a channel; their sends, and their receives, take
+    // turns.
+    class SharedMemoryChannel : public Connection {
+    public:
+        enum class Side {
+            CLIENT,
+            SERVER
+        };
+
+        // Creates the shared memory for a channel with rings of ringSize
+        // bytes (a power of two) and returns its descriptor, to be passed
+        // to the other process by fork() or over a Unix socket. The caller
+        // closes it.
+        static int CreateMemory(size_t ringSize = 1024 * 1024) {
+            if (!IsValidRingSize(ringSize)) {
+                throw std::system_error(EINVAL, std::generic_category(), "The ring size must be a power of two");
+            }
+
+            const int fd = ::memfd_create("jsonrpc-lean", MFD_CLOEXEC);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "memfd_create");
+            }
+            if (::ftruncate(fd, static_cast<off_t>(sizeof(SharedHeader) + 2 * ringSize)) != 0) {
+                const int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "ftruncate");
+            }
+
+            // A new memfd reads as zeros, which is an empty ring
+            void* memory = ::mmap(nullptr, sizeof(SharedHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (memory == MAP_FAILED) {
+                const int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "mmap");
+            }
+            auto header = static_cast<SharedHeader*>(memory);
+            header->RingSize = ringSize;
+            header->Magic = MAGIC;
+            ::munmap(memory, sizeof(SharedHeader));
+            return fd;
+        }
+
+        // Maps the memory created by CreateMemory, which may be any shared
+        // memory descriptor of that layout, as from shm_open. The
+        // descriptor can be closed afterwards.
+        SharedMemoryChannel(int fd, Side side, SharedMemoryOptions options = SharedMemoryOptions())
+            : myOptions(options) {
+            struct stat status;
+            if (::fstat(fd, &status) != 0) {
+                throw std::system_error(errno, std::generic_category(), "fstat");
+            }
+            mySize = static_cast<size_t>(status.st_size);
+            if (mySize < sizeof(SharedHeader)) {
+                throw std::system_error(EINVAL, std::generic_category(), "Not a jsonrpc-lean shared memory channel");
+            }
+            void* memory = ::mmap(nullptr, mySize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (memory == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "mmap");
+            }
+            myHeader = static_cast<SharedHeader*>(memory);
+            // The header comes from whoever created the memory, the ring
+            // size is checked before it is used in any arithmetic
+            if (myHeader->Magic != MAGIC || !IsValidRingSize(myHeader->RingSize)
+                || myHeader->RingSize > (mySize - sizeof(SharedHeader)) / 2
+                || mySize != sizeof(SharedHeader) + 2 * myHeader->RingSize) {
+                ::munmap(memory, mySize);
+                throw std::system_error(EINVAL, std::generic_category(), "Not a jsonrpc-lean shared memory channel");
+            }
+
+            const size_t ringSize = myHeader->RingSize;
+            char* rings = static_cast<char*>(memory) + sizeof(SharedHeader);
+            const int sending = side == Side::CLIENT ? 0 : 1;
+            mySending.Header = &myHeader->Rings[sending];
+            mySending.Data = rings + sending * ringSize;
+            mySending.Position = mySending.Header->Tail.load(std::memory_order_relaxed);
+            myReceiving.Header = &myHeader->Rings[1 - sending];
+            myReceiving.Data = rings + (1 - sending) * ringSize;
+            myReceiving.Position = myReceiving.Header->Head.load(std::memory_order_relaxed);
+            mySending.Mask = myReceiving.Mask = ringSize - 1;
+        }
+
+        ~SharedMemoryChannel() {
+            ::munmap(myHeader, mySize);
+        }
+
+        // Writes the message to the ring, waiting for room as needed.
+        // Throws InternalErrorFault once the channel is closed, or for a
+        // message of 4 GiB or more, whose size does not fit its prefix.
+        void Send(FormattedData& data) {
+            if (data.GetSize() > std::numeric_limits<uint32_t>::max()) {
+                throw InternalErrorFault("The message is too large for a shared memory channel");
+            }
+            std::lock_guard<std::mutex> lock(mySendMutex);
+            const uint32_t size = static_cast<uint32_t>(data.GetSize());
+            Write(reinterpret_cast<const char*>(&size), sizeof(size));
+            for (auto& segment : data.GetSegments()) {
+                Write(segment.Data, segment.Size);
+            }
+            Publish(mySending);
+        }
+
+        void Send(const std::shared_ptr<FormattedData>& data) override {
+            Send(*data);
+        }
+
+        // Waits for the next message. Returns false once the channel is
+        // closed and every message sent before has been received. A message
+        // over SharedMemoryOptions::MaxMessageSize, or a ring tail no writer
+        // could have stored, closes the channel and throws
+        // InternalErrorFault. Send does the same for a bad ring head.
+        bool Receive(std::string& message) {
+            std::lock_guard<std::mutex> lock(myReceiveMutex);
+            uint32_t size;
+            if (!Read(reinterpret_cast<char*>(&size), sizeof(size))) {
+                return false;
+            }
+            if (size > myOptions.MaxMessageSize) {
+                Close();
+                throw InternalErrorFault("The message is larger than the maximum message size");
+            }
+            message.resize(size);
+            if (size > 0 && !Read(&message[0], size)) {
+                return false;
+            }
+            Release(myReceiving);
+            return true;
+        }
+
+        // Handles requests with the server until the channel is closed,
+        // sending back the responses. Called on the server side.
+        void Serve(Server& server, const std::string& contentType = "application/json") {
+            std::string request;
+            while (Receive(request)) {
+                auto response = server.HandleRequest(request, contentType);
+                if (response && response->GetSize() > 0) {
+                    try {
+                        Send(*response);
+                    } catch (const InternalErrorFault&) {
+                        // Closed while the response was being written
+                        if (!IsClosed()) {
+                            throw;
+                        }
+                        return;
+                    }
+                }
+            }
+        }
+
+        // Closes the channel for both sides and wakes whoever is waiting
+        void Close() {
+            myHeader->IsClosed.store(1, std::memory_order_seq_cst);
+            for (auto& ring : myHeader->Rings) {
+                ring.DataSignal.fetch_add(1, std::memory_order_seq_cst);
+                Wake(ring.DataSignal);
+                ring.SpaceSignal.fetch_add(1, std::memory_order_seq_cst);
+                Wake(ring.SpaceSignal);
+            }
+        }
+
+        bool IsClosed() const {
+            return myHeader->IsClosed.load(std::memory_order_acquire) != 0;
+        }
+
+        SharedMemoryChannel(const SharedMemoryChannel&) = delete;
+        SharedMemoryChannel& operator=(const SharedMemoryChannel&) = delete;
+
+    private:
+        static const uint64_t MAGIC = 0x6a736f6e72706331; // "jsonrpc1"
+
+        // Head and tail count bytes ever read and written; each side only
+        // stores its own. The signals are futex words bumped to wake a side
+        // sleeping for data or for room, which it says it is by setting its
+        // waiting flag.
+        struct RingHeader {
+            alignas(64) std::atomic<uint64_t> Tail;
+            std::atomic<uint32_t> DataSignal;
+            std::atomic<uint32_t> IsReaderWaiting;
+            alignas(64) std::atomic<uint64_t> Head;
+            std::atomic<uint32_t> SpaceSignal;
+            std::atomic<uint32_t> IsWriterWaiting;
+        };
+
+        struct SharedHeader {
+            uint64_t Magic;
+            uint64_t RingSize;
+            std::atomic<uint32_t> IsClosed;
+            RingHeader Rings[2];
+        };
+
+        // One side's view of a ring; Position runs ahead of the shared
+        // head or tail until published
+        struct RingView {
+            RingHeader* Header = nullptr;
+            char* Data = nullptr;
+            uint64_t Mask = 0;
+            uint64_t Position = 0;
+        };
+
+        static bool IsValidRingSize(uint64_t ringSize) {
+            return ringSize >= 64 && (ringSize & (ringSize - 1)) == 0;
+        }
+
+        // For a head or tail the other process stored that no reader or
+        // writer could have: nothing more is copied to or from the ring
+        void ThrowCorrupt() {
+            Close();
+            throw InternalErrorFault("The shared memory channel is corrupt");
+        }
+
+        void Write(const char* data, size_t size) {
+            const uint64_t ringSize = mySending.Mask + 1;
+            while (size > 0) {
+                if (IsClosed()) {
+                    throw InternalErrorFault("The shared memory channel is closed");
+                }
+                const uint64_t head = mySending.Header->Head.load(std::memory_order_acquire);
+                if (head > mySending.Position || mySending.Position - head > ringSize) {
+                    ThrowCorrupt();
+                }
+                const uint64_t used = mySending.Position - head;
+                if (used == ringSize) {
+                    // Let the reader have what is there, then wait for room
+                    Publish(mySending);
+                    WaitFor(mySending.Header->SpaceSignal, mySending.Header->IsWriterWaiting, [this, ringSize]() {
+                        return mySending.Position - mySending.Header->Head.load(std::memory_order_acquire) < ringSize;
+                    });
+                    continue;
+                }
+
+                const size_t count = static_cast<size_t>(std::min<uint64_t>(size, ringSize - used));
+                Copy(mySending.Data, mySending.Mask, mySending.Position, data, count);
+                mySending.Position += count;
+                data += count;
+                size -= count;
+            }
+        }
+
+        bool Read(char* data, size_t size) {
+            while (size > 0) {
+                const uint64_t tail = myReceiving.Header->Tail.load(std::memory_order_acquire);
+                if (tail < myReceiving.Position || tail - myReceiving.Position > myReceiving.Mask + 1) {
+                    ThrowCorrupt();
+                }
+                const uint64_t available = tail - myReceiving.Position;
+                if (available == 0) {
+                    // Whatever was sent before the close is visible once the
+                    // close is
+                    if (IsClosed() && myReceiving.Header->Tail.load(std::memory_order_acquire) == myReceiving.Position) {
+                        return false;
+                    }
+                    // Give the writer back the room read so far, then wait
+                    Release(myReceiving);
+                    WaitFor(myReceiving.Header->DataSignal, myReceiving.Header->IsReaderWaiting, [this]() {
+                        return myReceiving.Header->Tail.load(std::memory_order_acquire) != myReceiving.Position;
+                    });
+                    continue;
+                }
+
+                const size_t count = static_cast<size_t>(std::min<uint64_t>(size, available));
+                const uint64_t offset = myReceiving.Position & myReceiving.Mask;
+                const size_t first = static_cast<size_t>(std::min<uint64_t>(count, myReceiving.Mask + 1 - offset));
+                std::memcpy(data, myReceiving.Data + offset, first);
+                std::memcpy(data + first, myReceiving.Data, count - first);
+                myReceiving.Position += count;
+                data += count;
+                size -= count;
+            }
+            return true;
+        }
+
+        static void Copy(char* ring, uint64_t mask, uint64_t position, const char* data, size_t size) {
+            const uint64_t offset = position & mask;
+            const size_t first = static_cast<size_t>(std::min<uint64_t>(size, mask + 1 - offset));
+            std::memcpy(ring + offset, data, first);
+            std::memcpy(ring, data + first, size - first);
+        }
+
+        // Makes the bytes written visible to the reader
+        static void Publish(RingView& ring) {
+            ring.Header->Tail.store(ring.Position, std::memory_order_release);
+            Signal(ring.Header->DataSignal, ring.Header->IsReaderWaiting);
+        }
+
+        // Hands the bytes read back to the writer
+        static void Release(RingView& ring) {
+            ring.Header->Head.store(ring.Position, std::memory_order_release);
+            Signal(ring.Header->SpaceSignal, ring.Header->IsWriterWaiting);
+        }
+
+        static void Signal(std::atomic<uint32_t>& signal, std::atomic<uint32_t>& isWaiting) {
+            // Orders the store of the head or tail before the load of the
+            // flag, pairing with the fence in WaitFor
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (isWaiting.load(std::memory_order_relaxed) != 0) {
+                signal.fetch_add(1, std::memory_order_release);
+                Wake(signal);
+            }
+        }
+
+        template<typename Condition>
+        void WaitFor(std::atomic<uint32_t>& signal, std::atomic<uint32_t>& isWaiting, Condition isReady) {
+            for (size_t i = 0; i < myOptions.SpinCount; ++i) {
+                if (isReady() || IsClosed()) {
+                    return;
+                }
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+            }
+
+            for (;;) {
+                const uint32_t value = signal.load(std::memory_order_acquire);
+                isWaiting.store(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (isReady() || IsClosed()) {
+                    isWaiting.store(0, std::memory_order_relaxed);
+                    return;
+                }
+                // Returns at once if the signal moved since it was read
+                ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&signal), FUTEX_WAIT, value, nullptr, nullptr, 0);
+            }
+        }
+
+        static void Wake(std::atomic<uint32_t>& signal) {
+            ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&signal), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+        }
+
+        SharedMemoryOptions myOptions;
+        SharedHeader* myHeader = nullptr;
+        size_t mySize = 0;
+        RingView mySending;
+        RingView myReceiving;
+        std::mutex mySendMutex;
+        std::mutex myReceiveMutex;
+    };
+
+} // namespace jsonrpc
+
+#endif // __linux__
+
+#endif // JSONRPC_LEAN_SHAREDMEMORY_H
@@ -0,0 +1,39 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_SIMDJSONFORMATHANDLER_H
+#define JSONRPC_LEAN_SIMDJSONFORMATHANDLER_H
+
+#include "jsonformathandler.h"
+#include "simdjsonreader.h"
+
+#include <memory>
+
+namespace jsonrpc {
+
+#ifdef JSONRPC_LEAN_HAS_SIMDJSON
+
+    // Parses with simdjson; everything else, responses included, is done as
+    // by JsonFormatHandler, whose settings apply. The SAX, parse arena and
+    // raw params settings are rapidjson specific and ignored.
+    class SimdJsonFormatHandler : public JsonFormatHandler {
+    public:
+        explicit SimdJsonFormatHandler() {}
+
+        std::unique_ptr<Reader> CreateReader(const std::string& data) override {
+            return std::unique_ptr<Reader>(std::make_unique<SimdJsonReader>(data, GetBinaryDetection()));
+        }
+    };
+
+#else
+
+    // Without simdjson the rapidjson based handler takes its place
+    typedef JsonFormatHandler SimdJsonFormatHandler;
+
+#endif // JSONRPC_LEAN_HAS_SIMDJSON
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_SIMDJSONFORMATHANDLER_H
@@ -0,0 +1,401 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_SIMDJSONREADER_H
+#define JSONRPC_LEAN_SIMDJSONREADER_H
+
+// simdjson needs C++17, it is picked up automatically when its header is on
+// the include path unless JSONRPC_LEAN_NO_SIMDJSON is defined
+#if !defined(JSONRPC_LEAN_NO_SIMDJSON) && defined(__has_include)
+#if __has_include(<simdjson.h>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#define JSONRPC_LEAN_HAS_SIMDJSON
+#endif
+#endif
+
+#ifdef JSONRPC_LEAN_HAS_SIMDJSON
+
+#include "reader.h"
+#include "fault.h"
+#include "json.h"
+#include "jsonreader.h"
+#include "request.h"
+#include "response.h"
+#include "util.h"
+#include "value.h"
+
+#include <simdjson.h>
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace jsonrpc {
+
+    class SimdJsonReader final : public Reader {
+    public:
+        SimdJsonReader(const std::string& data, BinaryDetection binaryDetection = BinaryDetection::NUL_BYTE)
+            : myBinaryDetection(binaryDetection) {
+            // Each thread keeps one parser around so that its buffers are
+            // reused, a reader created while another one is alive on the same
+            // thread gets a parser of its own
+            auto& slot = GetThreadParser();
+            if (!slot.InUse) {
+                slot.InUse = true;
+                mySlot = &slot;
+                myParser = &slot.Parser;
+            } else {
+                myOwnParser.reset(new simdjson::dom::parser());
+                myParser = myOwnParser.get();
+            }
+
+            auto error = myParser->parse(data).get(myRoot);
+            if (error) {
+                Release();
+                throw ParseErrorFault(
+                    "Parse error: " + std::to_string(static_cast<int>(error)));
+            }
+        }
+
+        ~SimdJsonReader() {
+            Release();
+        }
+
+        SimdJsonReader(const SimdJsonReader&) = delete;
+        SimdJsonReader& operator=(const SimdJsonReader&) = delete;
+
+        // Reader
+        Request GetRequest() override {
+            return GetRequest(myRoot);
+        }
+
+        bool IsBatch() override {
+            return myRoot.is_array();
+        }
+
+        size_t GetBatchSize() override {
+            return GetBatch().size();
+        }
+
+        Request GetBatchRequest(size_t index) override {
+            return GetRequest(GetBatch()[index]);
+        }
+
+        Response GetResponse() override {
+            return GetResponse(myRoot);
+        }
+
+        // A single response, as sent for a batch the server could not
+        // process, comes back on its own
+        std::vector<Response> GetBatchResponse() override {
+            std::vector<Response> responses;
+            simdjson::dom::array array;
+            if (myRoot.get(array)) {
+                responses.emplace_back(GetResponse(myRoot));
+                return responses;
+            }
+
+            responses.reserve(array.size());
+            for (auto element : array) {
+                responses.emplace_back(GetResponse(element));
+            }
+            return responses;
+        }
+
+        Value GetValue() override {
+            return GetValue(myRoot);
+        }
+
+    private:
+        struct ParserSlot {
+            simdjson::dom::parser Parser;
+            bool InUse = false;
+        };
+
+        // The top level members, collected in a single pass over the object
+        struct Envelope {
+            bool HasJsonrpc = false;
+            simdjson::dom::element Jsonrpc;
+            bool HasMethod = false;
+            simdjson::dom::element Method;
+            bool HasParams = false;
+            simdjson::dom::element Params;
+            bool HasId = false;
+            simdjson::dom::element Id;
+            bool HasResult = false;
+            simdjson::dom::element Result;
+            bool HasError = false;
+            simdjson::dom::element Error;
+        };
+
+        static ParserSlot& GetThreadParser() {
+            thread_local ParserSlot slot;
+            return slot;
+        }
+
+        void Release() {
+            if (mySlot != nullptr) {
+                mySlot->InUse = false;
+                mySlot = nullptr;
+            }
+        }
+
+        Request GetRequest(simdjson::dom::element element) const {
+            Envelope envelope = GetEnvelope(element);
+
+            ValidateJsonrpcVersion(envelope);
+
+            // A method id in place of the name, see Dispatcher::EnableMethodIds
+            std::string_view method;
+            int64_t methodId = -1;
+            if (!envelope.HasMethod
+                || (envelope.Method.get(method) && (envelope.Method.get(methodId) || methodId < 0
+                    || methodId > std::numeric_limits<int32_t>::max()))) {
+                throw InvalidRequestFault();
+            }
+
+            Request::Parameters parameters;
+            if (envelope.HasParams) {
+                simdjson::dom::array params;
+                if (envelope.Params.get(params)) {
+                    throw InvalidRequestFault();
+                }
+
+                for (auto param : params) {
+                    parameters.emplace_back(GetValue(param));
+                }
+            }
+
+            // Notification without an id
+            Value id = envelope.HasId ? GetId(envelope.Id) : Value(false);
+
+            if (methodId >= 0) {
+                return Request(static_cast<int32_t>(methodId), std::move(parameters), std::move(id));
+            }
+            return Request(std::string(method), std::move(parameters), std::move(id));
+        }
+
+        // The elements of a batch, collected once as indexing a
+        // simdjson::dom::array walks it from the start
+        const std::vector<simdjson::dom::element>& GetBatch() {
+            simdjson::dom::array array;
+            if (myBatch.empty() && !myRoot.get(array)) {
+                myBatch.reserve(array.size());
+                for (auto element : array) {
+                    myBatch.push_back(element);
+                }
+            }
+            return myBatch;
+        }
+
+        Response GetResponse(simdjson::dom::element element) const {
+            Envelope envelope = GetEnvelope(element);
+
+            ValidateJsonrpcVersion(envelope);
+
+            if (!envelope.HasId) {
+                throw InvalidRequestFault();
+            }
+
+            if (envelope.HasResult) {
+                if (envelope.HasError) {
+                    throw InvalidRequestFault();
+                }
+                return Response(GetValue(envelope.Result), GetId(envelope.Id));
+            } else if (envelope.HasError) {
+                simdjson::dom::object error;
+                if (envelope.Error.get(error)) {
+                    throw InvalidRequestFault();
+                }
+                int64_t code;
+                if (error[json::ERROR_CODE_NAME].get(code)
+                    || code < std::numeric_limits<int32_t>::min()
+                    || code > std::numeric_limits<int32_t>::max()) {
+                    throw InvalidRequestFault();
+                }
+                std::string_view message;
+                if (error[json::ERROR_MESSAGE_NAME].get(message)) {
+                    throw InvalidRequestFault();
+                }
+
+                return Response(static_cast<int32_t>(code), std::string(message),
+                    GetId(envelope.Id));
+            } else {
+                throw InvalidRequestFault();
+            }
+        }
+
+        Envelope GetEnvelope(simdjson::dom::element element) const {
+            simdjson::dom::object object;
+            if (element.get(object)) {
+                throw InvalidRequestFault();
+            }
+
+            // First occurrence wins, as with rapidjson's FindMember
+            Envelope envelope;
+            for (auto field : object) {
+                if (field.key == json::JSONRPC_NAME && !envelope.HasJsonrpc) {
+                    envelope.HasJsonrpc = true;
+                    envelope.Jsonrpc = field.value;
+                } else if (field.key == json::METHOD_NAME && !envelope.HasMethod) {
+                    envelope.HasMethod = true;
+                    envelope.Method = field.value;
+                } else if (field.key == json::PARAMS_NAME && !envelope.HasParams) {
+                    envelope.HasParams = true;
+                    envelope.Params = field.value;
+                } else if (field.key == json::ID_NAME && !envelope.HasId) {
+                    envelope.HasId = true;
+                    envelope.Id = field.value;
+                } else if (field.key == json::RESULT_NAME && !envelope.HasResult) {
+                    envelope.HasResult = true;
+                    envelope.Result = field.value;
+                } else if (field.key == json::ERROR_NAME && !envelope.HasError) {
+                    envelope.HasError = true;
+                    envelope.Error = field.value;
+                }
+            }
+            return envelope;
+        }
+
+        static void ValidateJsonrpcVersion(const Envelope& envelope) {
+            std::string_view version;
+            if (!envelope.HasJsonrpc
+                || envelope.Jsonrpc.get(version)
+                || version != json::JSONRPC_VERSION_2_0) {
+                throw InvalidRequestFault();
+            }
+        }
+
+        static Value GetInteger(int64_t value) {
+            if (value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max()) {
+                return Value(static_cast<int32_t>(value));
+            }
+            return Value(value);
+        }
+
+        Value GetValue(simdjson::dom::element element) const {
+            switch (element.type()) {
+            case simdjson::dom::element_type::NULL_VALUE:
+                return Value();
+            case simdjson::dom::element_type::BOOL:
+                return Value(element.get_bool().value_unsafe());
+            case simdjson::dom::element_type::OBJECT: {
+                Value::Struct data;
+                const simdjson::dom::object object = element.get_object().value_unsafe();
+                for (auto field : object) {
+                    data.emplace(std::string(field.key), GetValue(field.value));
+                }
+                return Value(std::move(data));
+            }
+            case simdjson::dom::element_type::ARRAY:
+                return GetArray(element.get_array().value_unsafe());
+            case simdjson::dom::element_type::STRING: {
+                auto str = element.get_string().value_unsafe();
+                return ReadJsonString(str.data(), str.size(), myBinaryDetection);
+            }
+            case simdjson::dom::element_type::INT64:
+                return GetInteger(element.get_int64().value_unsafe());
+            case simdjson::dom::element_type::UINT64:
+                // Only used above the int64_t range
+                return Value(static_cast<double>(element.get_uint64().value_unsafe()));
+            case simdjson::dom::element_type::DOUBLE:
+                return Value(element.get_double().value_unsafe());
+            default:
+                break;
+            }
+
+            throw InternalErrorFault();
+        }
+
+        // Homogeneous numeric arrays are stored contiguously, see JsonReader
+        Value GetArray(simdjson::dom::array array) const {
+            auto type = array.size() == 0 ? Value::Type::ARRAY : Value::Type::INTEGER_32_ARRAY;
+            for (auto element : array) {
+                if (type == Value::Type::ARRAY) {
+                    break;
+                }
+                switch (element.type()) {
+                case simdjson::dom::element_type::INT64: {
+                    const int64_t value = element.get_int64().value_unsafe();
+                    if (type == Value::Type::INTEGER_32_ARRAY
+                        && (value < std::numeric_limits<int32_t>::min() || value > std::numeric_limits<int32_t>::max())) {
+                        type = Value::Type::INTEGER_64_ARRAY;
+                    }
+                    break;
+                }
+                case simdjson::dom::element_type::UINT64:
+                case simdjson::dom::element_type::DOUBLE:
+                    type = Value::Type::DOUBLE_ARRAY;
+                    break;
+                default:
+                    type = Value::Type::ARRAY;
+                    break;
+                }
+            }
+
+            switch (type) {
+            case Value::Type::INTEGER_32_ARRAY: {
+                Value::Integer32Array values;
+                values.reserve(array.size());
+                for (auto element : array) {
+                    values.push_back(static_cast<int32_t>(element.get_int64().value_unsafe()));
+                }
+                return Value(std::move(values));
+            }
+            case Value::Type::INTEGER_64_ARRAY: {
+                Value::Integer64Array values;
+                values.reserve(array.size());
+                for (auto element : array) {
+                    values.push_back(element.get_int64().value_unsafe());
+                }
+                return Value(std::move(values));
+            }
+            case Value::Type::DOUBLE_ARRAY: {
+                Value::DoubleArray values;
+                values.reserve(array.size());
+                for (auto element : array) {
+                    values.push_back(element.get_double().value_unsafe());
+                }
+                return Value(std::move(values));
+            }
+            default: {
+                Value::Array values;
+                values.reserve(array.size());
+                for (auto element : array) {
+                    values.emplace_back(GetValue(element));
+                }
+                return Value(std::move(values));
+            }
+            }
+        }
+
+        static Value GetId(simdjson::dom::element id) {
+            switch (id.type()) {
+            case simdjson::dom::element_type::STRING:
+                return Value(std::string(id.get_string().value_unsafe()));
+            case simdjson::dom::element_type::INT64:
+                return GetInteger(id.get_int64().value_unsafe());
+            case simdjson::dom::element_type::NULL_VALUE:
+                return{};
+            default:
+                break;
+            }
+
+            throw InvalidRequestFault();
+        }
+
+        BinaryDetection myBinaryDetection;
+        ParserSlot* mySlot = nullptr;
+        std::unique_ptr<simdjson::dom::parser> myOwnParser;
+        simdjson::dom::parser* myParser = nullptr;
+        simdjson::dom::element myRoot;
+        std::vector<simdjson::dom::element> myBatch;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_HAS_SIMDJSON
+
+#endif // JSONRPC_LEAN_SIMDJSONREADER_H
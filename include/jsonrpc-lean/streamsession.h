@@ -0,0 +1,129 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_STREAMSESSION_H
+#define JSONRPC_LEAN_STREAMSESSION_H
+
+#include "framer.h"
+#include "server.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace jsonrpc {
+
+    // The part of a stream connection that does not depend on how bytes are
+    // read and written: buffers the input, hands each message the Framer
+    // finds to Server::HandleRequest and collects the framed responses.
+    //
+    // Messages are handled one after another in the order they arrive, so
+    // responses to pipelined requests go out in request order. Responses to
+    // all the messages in one read are collected into one output buffer,
+    // sent with a single write.
+    class StreamSession {
+    public:
+        StreamSession(Server& server, std::unique_ptr<Framer> framer)
+            : myServer(server), myFramer(std::move(framer)) {}
+
+        // Space at the end of the input to read at least minSize bytes into
+        char* GetReadBuffer(size_t minSize, size_t& size) {
+            if (myInputStart > 0 && myInputStart == myInputEnd) {
+                myInputStart = myInputEnd = 0;
+            }
+            if (myInput.size() - myInputEnd < minSize) {
+                if (myInputStart > 0) {
+                    std::memmove(&myInput[0], myInput.data() + myInputStart, myInputEnd - myInputStart);
+                    myInputEnd -= myInputStart;
+                    myInputStart = 0;
+                }
+                if (myInput.size() - myInputEnd < minSize) {
+                    myInput.resize(std::max(myInput.size() * 2, myInputEnd + minSize));
+                }
+            }
+            size = myInput.size() - myInputEnd;
+            return &myInput[myInputEnd];
+        }
+
+        // Adds size bytes read into the buffer from GetReadBuffer and handles
+        // the complete messages. Throws a Fault for input the framer
+        // rejects, after which the connection should be closed.
+        void CommitRead(size_t size) {
+            myInputEnd += size;
+            HandleMessages();
+        }
+
+        // As CommitRead, for bytes read somewhere else
+        void Append(const char* data, size_t size) {
+            size_t space;
+            std::memcpy(GetReadBuffer(size, space), data, size);
+            CommitRead(size);
+        }
+
+        const char* GetOutput() const { return myOutput.data() + myOutputStart; }
+        size_t GetOutputSize() const { return myOutput.size() - myOutputStart; }
+
+        // Drops size bytes written from the start of the output
+        void ConsumeOutput(size_t size) {
+            myOutputStart += size;
+            if (myOutputStart == myOutput.size()) {
+                myOutput.clear();
+                myOutputStart = 0;
+            }
+        }
+
+        // Swaps the output, whatever is left of it, with output, which is
+        // cleared first. For writers that need the bytes to stay where they
+        // are while the session goes on collecting responses; handing the
+        // same string back each time reuses its capacity.
+        void TakeOutput(std::string& output) {
+            output.clear();
+            if (myOutputStart > 0) {
+                myOutput.erase(0, myOutputStart);
+                myOutputStart = 0;
+            }
+            output.swap(myOutput);
+        }
+
+        // Whether the connection is to be closed once the output is sent
+        bool IsClosing() const { return myFramer->IsClosing(); }
+
+    private:
+        void HandleMessages() {
+            while (myInputStart < myInputEnd && !myFramer->IsClosing()) {
+                size_t consumed = 0;
+                const bool hasMessage = myFramer->ReadMessage(myInput.data() + myInputStart,
+                    myInputEnd - myInputStart, consumed, myBody, myContentType);
+                myInputStart += consumed;
+                if (!hasMessage) {
+                    myFramer->WritePending(myOutput);
+                    break;
+                }
+
+                auto response = myServer.HandleRequest(myBody, myContentType);
+                if (response) {
+                    myFramer->WriteResponse(*response, myOutput);
+                } else {
+                    myFramer->WriteUnsupported(myOutput);
+                }
+            }
+        }
+
+        Server& myServer;
+        std::unique_ptr<Framer> myFramer;
+        std::string myInput;
+        size_t myInputStart = 0;
+        size_t myInputEnd = 0;
+        std::string myOutput;
+        size_t myOutputStart = 0;
+        // Reused between messages for their capacity
+        std::string myBody;
+        std::string myContentType;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_STREAMSESSION_H
@@ -0,0 +1,766 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_TCPSERVER_H
+#define JSONRPC_LEAN_TCPSERVER_H
+
+#ifdef __linux__
+
+#if !defined(JSONRPC_LEAN_NO_URING) && defined(__has_include)
+#if __has_include(<liburing.h>)
+#define JSONRPC_LEAN_HAS_URING
+#endif
+#endif
+
+#include "framer.h"
+#include "server.h"
+#include "streamsession.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef JSONRPC_LEAN_HAS_URING
+#include <liburing.h>
+#endif
+
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace jsonrpc {
+
+    enum class TcpBackend {
+        EPOLL,
+        // Needs liburing at build time, see JSONRPC_LEAN_HAS_URING
+        IO_URING
+    };
+
+    struct TcpServerOptions {
+        // A numeric IPv4 or IPv6 address
+        std::string Address = "127.0.0.1";
+        // 0 picks a free port, see TcpServer::GetPort
+        uint16_t Port = 0;
+        // Reactor threads, each with its own listening socket and epoll
+        // instance; the kernel spreads new connections over them
+        size_t ThreadCount = 1;
+        // A connection is not read from while this much output is waiting
+        // for a client that does not read its responses
+        size_t MaxPendingOutput = 4 * 1024 * 1024;
+        FramerFactory Framers = NdjsonFramer::Factory();
+        TcpBackend Backend = TcpBackend::EPOLL;
+
+        // io_uring only: submission queue entries per reactor, and the
+        // number (a power of two) and size of the buffers the kernel
+        // receives into
+        unsigned RingEntries = 1024;
+        unsigned ReceiveBufferCount = 256;
+        unsigned ReceiveBufferSize = 16 * 1024;
+    };
+
+    // Serves a Server over TCP on Linux. Every reactor thread accepts on a
+    // SO_REUSEPORT listening socket and handles its connections with
+    // edge-triggered epoll; a connection stays on the thread that accepted
+    // it. Methods are called on the reactor threads, so with more than one
+    // thread they must be safe to call concurrently.
+    class TcpServer {
+    public:
+        explicit TcpServer(Server& server, TcpServerOptions options = TcpServerOptions())
+            : myServer(server), myOptions(std::move(options)) {}
+
+        ~TcpServer() {
+            Stop();
+        }
+
+        // Binds the listening sockets and starts the reactor threads. Throws
+        // std::system_error when a socket cannot be set up.
+        void Start() {
+            if (!myReactors.empty()) {
+                return;
+            }
+
+            try {
+                const size_t threadCount = myOptions.ThreadCount > 0 ? myOptions.ThreadCount : 1;
+                for (size_t i = 0; i < threadCount; ++i) {
+                    myReactors.emplace_back(CreateReactor(Listen()));
+                }
+            }
+            catch (...) {
+                myReactors.clear();
+                throw;
+            }
+            for (auto& reactor : myReactors) {
+                reactor->Start();
+            }
+        }
+
+        // Closes the listening sockets and every connection, and waits for
+        // the reactor threads to finish
+        void Stop() {
+            for (auto& reactor : myReactors) {
+                reactor->Wake();
+            }
+            for (auto& reactor : myReactors) {
+                reactor->Join();
+            }
+            myReactors.clear();
+        }
+
+        // The port listened on, once started
+        uint16_t GetPort() const { return myPort; }
+
+        TcpServer(const TcpServer&) = delete;
+        TcpServer& operator=(const TcpServer&) = delete;
+        TcpServer(TcpServer&&) = delete;
+        TcpServer& operator=(TcpServer&&) = delete;
+
+    private:
+        static void ThrowSystemError(const char* what) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        // Owns a file descriptor
+        class FileDescriptor {
+        public:
+            explicit FileDescriptor(int fd = -1) : myFd(fd) {}
+            ~FileDescriptor() { if (myFd >= 0) { ::close(myFd); } }
+
+            FileDescriptor(const FileDescriptor&) = delete;
+            FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+            int Get() const { return myFd; }
+
+            int Release() {
+                const int fd = myFd;
+                myFd = -1;
+                return fd;
+            }
+
+        private:
+            int myFd;
+        };
+
+        int Listen() {
+            addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV | AI_PASSIVE;
+            addrinfo* address = nullptr;
+            const int error = ::getaddrinfo(myOptions.Address.c_str(), std::to_string(myPort != 0 ? myPort : myOptions.Port).c_str(), &hints, &address);
+            if (error != 0) {
+                throw std::system_error(EINVAL, std::generic_category(), ::gai_strerror(error));
+            }
+            std::unique_ptr<addrinfo, void(*)(addrinfo*)> addressOwner(address, ::freeaddrinfo);
+
+            FileDescriptor fd(::socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+            if (fd.Get() < 0) {
+                ThrowSystemError("socket");
+            }
+            const int on = 1;
+            if (::setsockopt(fd.Get(), SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+                || ::setsockopt(fd.Get(), SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+                ThrowSystemError("setsockopt");
+            }
+            if (::bind(fd.Get(), address->ai_addr, address->ai_addrlen) != 0) {
+                ThrowSystemError("bind");
+            }
+            if (::listen(fd.Get(), SOMAXCONN) != 0) {
+                ThrowSystemError("listen");
+            }
+
+            if (myPort == 0) {
+                sockaddr_storage bound = {};
+                socklen_t size = sizeof(bound);
+                if (::getsockname(fd.Get(), reinterpret_cast<sockaddr*>(&bound), &size) != 0) {
+                    ThrowSystemError("getsockname");
+                }
+                myPort = ntohs(bound.ss_family == AF_INET6
+                    ? reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port
+                    : reinterpret_cast<sockaddr_in*>(&bound)->sin_port);
+            }
+
+            return fd.Release();
+        }
+
+        struct TcpConnection {
+            // Takes the descriptor over once it is sure to be constructed,
+            // until then it stays with the caller
+            TcpConnection(FileDescriptor& fd, Server& server, std::unique_ptr<Framer> framer)
+                : Fd(fd.Release()), Session(server, std::move(framer)) {}
+
+            FileDescriptor Fd;
+            StreamSession Session;
+            // Set when reading stopped for MaxPendingOutput, so it is
+            // resumed once the output drains; edge-triggered epoll will not
+            // report the input already there again
+            bool IsReadPaused = false;
+            bool IsEndOfInput = false;
+        };
+
+        // A thread serving the connections of one listening socket, until
+        // woken to stop
+        class Reactor {
+        public:
+            Reactor(TcpServer& owner, int listener)
+                : myOwner(owner), myListener(listener), myWake(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+                if (myWake.Get() < 0) {
+                    ThrowSystemError("eventfd");
+                }
+            }
+
+            virtual ~Reactor() {
+                Join();
+            }
+
+            void Start() {
+                myThread = std::thread([this]() { Run(); });
+            }
+
+            void Wake() {
+                const uint64_t one = 1;
+                (void)::write(myWake.Get(), &one, sizeof(one));
+            }
+
+            // Called before destruction, while the derived reactor is whole
+            void Join() {
+                if (myThread.joinable()) {
+                    myThread.join();
+                }
+            }
+
+        protected:
+            virtual void Run() = 0;
+
+            TcpServer& myOwner;
+            FileDescriptor myListener;
+            FileDescriptor myWake;
+
+        private:
+            std::thread myThread;
+        };
+
+        class EpollReactor : public Reactor {
+        public:
+            EpollReactor(TcpServer& owner, int listener)
+                : Reactor(owner, listener), myEpoll(::epoll_create1(EPOLL_CLOEXEC)) {
+                if (myEpoll.Get() < 0) {
+                    ThrowSystemError("epoll_create1");
+                }
+                Watch(myListener.Get(), EPOLLIN | EPOLLET);
+                Watch(myWake.Get(), EPOLLIN);
+            }
+
+        private:
+            static const int MAX_EVENTS = 256;
+            static const size_t READ_SIZE = 64 * 1024;
+
+            void Watch(int fd, uint32_t events) {
+                epoll_event event = {};
+                event.events = events;
+                event.data.fd = fd;
+                if (::epoll_ctl(myEpoll.Get(), EPOLL_CTL_ADD, fd, &event) != 0) {
+                    ThrowSystemError("epoll_ctl");
+                }
+            }
+
+            void Run() override {
+                epoll_event events[MAX_EVENTS];
+                for (;;) {
+                    const int count = ::epoll_wait(myEpoll.Get(), events, MAX_EVENTS, -1);
+                    if (count < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        return;
+                    }
+
+                    for (int i = 0; i < count; ++i) {
+                        const int fd = events[i].data.fd;
+                        if (fd == myWake.Get()) {
+                            return;
+                        }
+                        if (fd == myListener.Get()) {
+                            Accept();
+                            continue;
+                        }
+
+                        auto connection = myConnections.find(fd);
+                        if (connection == myConnections.end()) {
+                            continue;
+                        }
+                        if (!HandleEvents(*connection->second, events[i].events)) {
+                            myConnections.erase(connection);
+                        }
+                    }
+                }
+            }
+
+            void Accept() {
+                for (;;) {
+                    const int fd = ::accept4(myListener.Get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (fd < 0) {
+                        if (errno == EINTR || errno == ECONNABORTED) {
+                            continue;
+                        }
+                        // EAGAIN, or out of descriptors until some close
+                        return;
+                    }
+
+                    // A framer factory that throws, or running out of memory,
+                    // refuses this connection only; whoever owns the
+                    // descriptor by then closes it
+                    try {
+                        FileDescriptor accepted(fd);
+                        std::unique_ptr<TcpConnection> connection(new TcpConnection(accepted, myOwner.myServer, myOwner.myOptions.Framers()));
+                        const int on = 1;
+                        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                        epoll_event event = {};
+                        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                        event.data.fd = fd;
+                        if (::epoll_ctl(myEpoll.Get(), EPOLL_CTL_ADD, fd, &event) == 0) {
+                            myConnections[fd] = std::move(connection);
+                        }
+                    }
+                    catch (...) {
+                    }
+                }
+            }
+
+            // Returns false once the connection is to be closed
+            bool HandleEvents(TcpConnection& connection, uint32_t events) {
+                if (events & EPOLLERR) {
+                    return false;
+                }
+                try {
+                    if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) && !Read(connection)) {
+                        return false;
+                    }
+                    for (;;) {
+                        if (!Write(connection)) {
+                            return false;
+                        }
+                        // Output drained below the limit, pick up the input
+                        // left unread
+                        if (!connection.IsReadPaused
+                            || connection.Session.GetOutputSize() >= myOwner.myOptions.MaxPendingOutput) {
+                            break;
+                        }
+                        connection.IsReadPaused = false;
+                        if (!Read(connection)) {
+                            return false;
+                        }
+                    }
+                }
+                catch (...) {
+                    // Input the framer rejected, or out of memory
+                    return false;
+                }
+                return !(connection.Session.GetOutputSize() == 0
+                    && (connection.IsEndOfInput || connection.Session.IsClosing()));
+            }
+
+            // Reads until the socket has nothing more, handling the messages
+            // as they come in. Returns false on errors.
+            bool Read(TcpConnection& connection) {
+                while (!connection.IsEndOfInput && !connection.Session.IsClosing()) {
+                    if (connection.Session.GetOutputSize() >= myOwner.myOptions.MaxPendingOutput) {
+                        connection.IsReadPaused = true;
+                        return true;
+                    }
+
+                    size_t size;
+                    char* buffer = connection.Session.GetReadBuffer(READ_SIZE, size);
+                    const ssize_t received = ::recv(connection.Fd.Get(), buffer, size, 0);
+                    if (received > 0) {
+                        connection.Session.CommitRead(static_cast<size_t>(received));
+                    } else if (received == 0) {
+                        connection.IsEndOfInput = true;
+                    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        return true;
+                    } else if (errno != EINTR) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            // Writes as much of the output as the socket takes. Returns false
+            // on errors.
+            bool Write(TcpConnection& connection) {
+                while (connection.Session.GetOutputSize() > 0) {
+                    const ssize_t sent = ::send(connection.Fd.Get(), connection.Session.GetOutput(),
+                        connection.Session.GetOutputSize(), MSG_NOSIGNAL);
+                    if (sent >= 0) {
+                        connection.Session.ConsumeOutput(static_cast<size_t>(sent));
+                    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        return true;
+                    } else if (errno != EINTR) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            FileDescriptor myEpoll;
+            std::unordered_map<int, std::unique_ptr<TcpConnection>> myConnections;
+        };
+
+#ifdef JSONRPC_LEAN_HAS_URING
+        // Serves connections with io_uring: a multishot accept, a multishot
+        // receive per connection into a ring of buffers provided to the
+        // kernel, and the sends of all the responses produced by one batch
+        // of completions submitted together with the next wait.
+        class UringReactor : public Reactor {
+        public:
+            UringReactor(TcpServer& owner, int listener)
+                : Reactor(owner, listener),
+                myBufferCount(owner.myOptions.ReceiveBufferCount),
+                myBufferSize(owner.myOptions.ReceiveBufferSize) {
+                if (myBufferCount == 0 || (myBufferCount & (myBufferCount - 1)) != 0 || myBufferCount > 32768) {
+                    throw std::system_error(EINVAL, std::generic_category(), "ReceiveBufferCount must be a power of two");
+                }
+
+                io_uring_params params = {};
+                params.flags = IORING_SETUP_COOP_TASKRUN;
+                int result = ::io_uring_queue_init_params(owner.myOptions.RingEntries, &myRing, &params);
+                if (result == -EINVAL) {
+                    // A kernel before 5.19
+                    params = {};
+                    result = ::io_uring_queue_init_params(owner.myOptions.RingEntries, &myRing, &params);
+                }
+                if (result < 0) {
+                    throw std::system_error(-result, std::generic_category(), "io_uring_queue_init_params");
+                }
+
+                myBuffers.reset(new char[static_cast<size_t>(myBufferCount) * myBufferSize]);
+                myBufferRing = ::io_uring_setup_buf_ring(&myRing, myBufferCount, BUFFER_GROUP, 0, &result);
+                if (myBufferRing == nullptr) {
+                    ::io_uring_queue_exit(&myRing);
+                    throw std::system_error(-result, std::generic_category(), "io_uring_setup_buf_ring");
+                }
+                for (unsigned i = 0; i < myBufferCount; ++i) {
+                    ReturnBuffer(static_cast<unsigned short>(i));
+                }
+                FlushBuffers();
+
+                AcceptMultishot();
+                auto sqe = GetSqe();
+                ::io_uring_prep_read(sqe, myWake.Get(), &myWakeValue, sizeof(myWakeValue), 0);
+                ::io_uring_sqe_set_data64(sqe, WAKE);
+            }
+
+            ~UringReactor() {
+                Join();
+                ::io_uring_free_buf_ring(&myRing, myBufferRing, myBufferCount, BUFFER_GROUP);
+                ::io_uring_queue_exit(&myRing);
+            }
+
+        private:
+            // The low bits of a submission's user data say what it was,
+            // the rest which connection it was for
+            enum : uint64_t {
+                ACCEPT = 1,
+                WAKE = 2,
+                RECEIVE = 3,
+                SEND = 4,
+                CANCEL = 5,
+                OPERATION_BITS = 3,
+                OPERATION_MASK = (1 << OPERATION_BITS) - 1
+            };
+
+            static const int BUFFER_GROUP = 0;
+            static const unsigned MAX_COMPLETIONS = 256;
+
+            struct UringConnection : TcpConnection {
+                UringConnection(uint64_t id, FileDescriptor& fd, Server& server, std::unique_ptr<Framer> framer)
+                    : TcpConnection(fd, server, std::move(framer)), Id(id) {}
+
+                uint64_t Id;
+                // Submissions not yet completed for good; the connection
+                // is only destroyed once there are none
+                int InFlight = 0;
+                bool IsReceiving = false;
+                bool IsSending = false;
+                bool IsClosing = false;
+                // Output taken from the session, which must not move while
+                // the kernel sends it
+                std::string Sending;
+                size_t SendingStart = 0;
+            };
+
+            void Run() override {
+                io_uring_cqe* completions[MAX_COMPLETIONS];
+                for (;;) {
+                    const int result = ::io_uring_submit_and_wait(&myRing, 1);
+                    if (result < 0 && result != -EINTR && result != -EBUSY) {
+                        return;
+                    }
+
+                    const unsigned count = ::io_uring_peek_batch_cqe(&myRing, completions, MAX_COMPLETIONS);
+                    for (unsigned i = 0; i < count; ++i) {
+                        HandleCompletion(*completions[i]);
+                    }
+                    ::io_uring_cq_advance(&myRing, count);
+                    FlushBuffers();
+
+                    // The kernel may still be using the buffers until all
+                    // that was submitted has completed
+                    if (myIsStopping && !myIsAccepting && myConnections.empty()) {
+                        return;
+                    }
+                }
+            }
+
+            void HandleCompletion(const io_uring_cqe& cqe) {
+                const uint64_t data = ::io_uring_cqe_get_data64(&cqe);
+                switch (data & OPERATION_MASK) {
+                case WAKE:
+                    Stop();
+                    return;
+                case ACCEPT:
+                    if (cqe.res >= 0) {
+                        if (myIsStopping) {
+                            ::close(cqe.res);
+                        } else {
+                            AddConnection(cqe.res);
+                        }
+                    }
+                    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                        myIsAccepting = false;
+                        if (!myIsStopping) {
+                            AcceptMultishot();
+                        }
+                    }
+                    return;
+                case RECEIVE:
+                case SEND: {
+                    auto found = myConnections.find(data >> OPERATION_BITS);
+                    if (found == myConnections.end()) {
+                        if ((data & OPERATION_MASK) == RECEIVE && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                            ReturnBuffer(static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+                        }
+                        return;
+                    }
+                    auto& connection = *found->second;
+                    if ((data & OPERATION_MASK) == RECEIVE) {
+                        Received(connection, cqe);
+                    } else {
+                        Sent(connection, cqe);
+                    }
+                    if (!Update(connection)) {
+                        myConnections.erase(found);
+                    }
+                    return;
+                }
+                default:
+                    return;
+                }
+            }
+
+            void Stop() {
+                myIsStopping = true;
+                auto sqe = GetSqe();
+                ::io_uring_prep_cancel64(sqe, ACCEPT, 0);
+                ::io_uring_sqe_set_data64(sqe, CANCEL);
+                for (auto connection = myConnections.begin(); connection != myConnections.end();) {
+                    Close(*connection->second);
+                    if (Update(*connection->second)) {
+                        ++connection;
+                    } else {
+                        connection = myConnections.erase(connection);
+                    }
+                }
+            }
+
+            // As with EpollReactor::Accept, a connection that cannot be set
+            // up is closed and the others are served on. It is added before
+            // its receive is submitted, which cannot fail.
+            void AddConnection(int fd) {
+                try {
+                    FileDescriptor accepted(fd);
+                    const int on = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                    const uint64_t id = ++myLastConnectionId;
+                    std::unique_ptr<UringConnection> connection(new UringConnection(id, accepted, myOwner.myServer, myOwner.myOptions.Framers()));
+                    auto& added = *connection;
+                    myConnections[id] = std::move(connection);
+                    ReceiveMultishot(added);
+                }
+                catch (...) {
+                }
+            }
+
+            void Received(UringConnection& connection, const io_uring_cqe& cqe) {
+                if (cqe.flags & IORING_CQE_F_BUFFER) {
+                    const auto buffer = static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                    if (cqe.res > 0 && !connection.IsClosing) {
+                        try {
+                            connection.Session.Append(myBuffers.get() + static_cast<size_t>(buffer) * myBufferSize,
+                                static_cast<size_t>(cqe.res));
+                        }
+                        catch (...) {
+                            Close(connection);
+                        }
+                    }
+                    ReturnBuffer(buffer);
+                }
+
+                if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                    connection.IsReceiving = false;
+                    --connection.InFlight;
+                    if (cqe.res == 0) {
+                        connection.IsEndOfInput = true;
+                    } else if (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+                        Close(connection);
+                    }
+                }
+            }
+
+            void Sent(UringConnection& connection, const io_uring_cqe& cqe) {
+                connection.IsSending = false;
+                --connection.InFlight;
+                if (cqe.res < 0) {
+                    Close(connection);
+                    return;
+                }
+                connection.SendingStart += static_cast<size_t>(cqe.res);
+                if (connection.SendingStart == connection.Sending.size()) {
+                    connection.Sending.clear();
+                    connection.SendingStart = 0;
+                }
+            }
+
+            // Starts what the connection needs next. Returns false once it
+            // is closed and has nothing in flight.
+            bool Update(UringConnection& connection) {
+                if (!connection.IsClosing) {
+                    if (!connection.IsSending) {
+                        if (connection.Sending.empty() && connection.Session.GetOutputSize() > 0) {
+                            connection.Session.TakeOutput(connection.Sending);
+                        }
+                        if (!connection.Sending.empty()) {
+                            auto sqe = GetSqe();
+                            ::io_uring_prep_send(sqe, connection.Fd.Get(), connection.Sending.data() + connection.SendingStart,
+                                connection.Sending.size() - connection.SendingStart, MSG_NOSIGNAL);
+                            ::io_uring_sqe_set_data64(sqe, connection.Id << OPERATION_BITS | SEND);
+                            connection.IsSending = true;
+                            ++connection.InFlight;
+                        }
+                    }
+                    const size_t output = connection.Sending.size() - connection.SendingStart
+                        + connection.Session.GetOutputSize();
+
+                    const bool isInputDone = connection.IsEndOfInput || connection.Session.IsClosing();
+                    if (output == 0 && isInputDone) {
+                        Close(connection);
+                    } else if (output >= myOwner.myOptions.MaxPendingOutput) {
+                        // Stop receiving until the client reads its responses
+                        if (connection.IsReceiving && !connection.IsReadPaused) {
+                            auto sqe = GetSqe();
+                            ::io_uring_prep_cancel64(sqe, connection.Id << OPERATION_BITS | RECEIVE, 0);
+                            ::io_uring_sqe_set_data64(sqe, CANCEL);
+                            connection.IsReadPaused = true;
+                        }
+                    } else if (!connection.IsReceiving && !isInputDone) {
+                        connection.IsReadPaused = false;
+                        ReceiveMultishot(connection);
+                    }
+                }
+                return !(connection.IsClosing && connection.InFlight == 0);
+            }
+
+            // Ends what is in flight on the connection; its completions come
+            // in before it is destroyed
+            void Close(UringConnection& connection) {
+                if (!connection.IsClosing) {
+                    connection.IsClosing = true;
+                    ::shutdown(connection.Fd.Get(), SHUT_RDWR);
+                }
+            }
+
+            void AcceptMultishot() {
+                auto sqe = GetSqe();
+                ::io_uring_prep_multishot_accept(sqe, myListener.Get(), nullptr, nullptr, SOCK_CLOEXEC);
+                ::io_uring_sqe_set_data64(sqe, ACCEPT);
+                myIsAccepting = true;
+            }
+
+            void ReceiveMultishot(UringConnection& connection) {
+                auto sqe = GetSqe();
+                ::io_uring_prep_recv_multishot(sqe, connection.Fd.Get(), nullptr, 0, 0);
+                sqe->flags |= IOSQE_BUFFER_SELECT;
+                sqe->buf_group = BUFFER_GROUP;
+                ::io_uring_sqe_set_data64(sqe, connection.Id << OPERATION_BITS | RECEIVE);
+                connection.IsReceiving = true;
+                ++connection.InFlight;
+            }
+
+            io_uring_sqe* GetSqe() {
+                io_uring_sqe* sqe;
+                while ((sqe = ::io_uring_get_sqe(&myRing)) == nullptr) {
+                    ::io_uring_submit(&myRing);
+                }
+                return sqe;
+            }
+
+            // Buffers go back to the kernel in one step per batch of
+            // completions
+            void ReturnBuffer(unsigned short buffer) {
+                ::io_uring_buf_ring_add(myBufferRing, myBuffers.get() + static_cast<size_t>(buffer) * myBufferSize,
+                    myBufferSize, buffer, ::io_uring_buf_ring_mask(myBufferCount), myReturnedBuffers++);
+            }
+
+            void FlushBuffers() {
+                if (myReturnedBuffers > 0) {
+                    ::io_uring_buf_ring_advance(myBufferRing, myReturnedBuffers);
+                    myReturnedBuffers = 0;
+                }
+            }
+
+            const unsigned myBufferCount;
+            const unsigned myBufferSize;
+            io_uring myRing;
+            io_uring_buf_ring* myBufferRing = nullptr;
+            std::unique_ptr<char[]> myBuffers;
+            int myReturnedBuffers = 0;
+            uint64_t myWakeValue = 0;
+            uint64_t myLastConnectionId = 0;
+            bool myIsAccepting = false;
+            bool myIsStopping = false;
+            std::unordered_map<uint64_t, std::unique_ptr<UringConnection>> myConnections;
+        };
+#endif // JSONRPC_LEAN_HAS_URING
+
+        Reactor* CreateReactor(int listener) {
+            if (myOptions.Backend == TcpBackend::IO_URING) {
+#ifdef JSONRPC_LEAN_HAS_URING
+                return new UringReactor(*this, listener);
+#else
+                ::close(listener);
+                throw std::system_error(ENOSYS, std::generic_category(), "io_uring support was not built in");
+#endif
+            }
+            return new EpollReactor(*this, listener);
+        }
+
+        Server& myServer;
+        TcpServerOptions myOptions;
+        uint16_t myPort = 0;
+        std::vector<std::unique_ptr<Reactor>> myReactors;
+    };
+
+} // namespace jsonrpc
+
+#endif // __linux__
+
+#endif // JSONRPC_LEAN_TCPSERVER_H
@@ -0,0 +1,122 @@
+// This file is part of jsonrpc-lean, a c++11 JSON-RPC client/server library.
+//
+// Copyright (C) 2015 Adriano Maia <tony@stark.im>
+//
+
+#ifndef JSONRPC_LEAN_TRANSPORT_H
+#define JSONRPC_LEAN_TRANSPORT_H
+
+#include "client.h"
+#include "dispatcher.h"
+#include "request.h"
+#include "response.h"
+#include "value.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+namespace jsonrpc {
+
+    // Gets calls to a Dispatcher and their results back, wherever the
+    // dispatcher is. Code written against Transport behaves the same with
+    // the in-process LoopbackTransport as with one going over a connection.
+    class Transport {
+    public:
+        virtual ~Transport() {}
+
+        // Returns the result of the call, throws the Fault of a fault response
+        Value Call(const std::string& methodName, const Request::Parameters& params = {}) {
+            return CallInternal(methodName, params);
+        }
+
+        template<typename FirstType, typename... RestTypes>
+        typename std::enable_if<!std::is_same<typename std::decay<FirstType>::type, Request::Parameters>::value, Value>::type
+        Call(const std::string& methodName, FirstType&& first, RestTypes&&... rest) {
+            Request::Parameters params;
+            AddParameters(params, std::forward<FirstType>(first), std::forward<RestTypes>(rest)...);
+            return CallInternal(methodName, params);
+        }
+
+        // Faults of notifications are never seen, as with JSON-RPC
+        void Notify(const std::string& methodName, const Request::Parameters& params = {}) {
+            NotifyInternal(methodName, params);
+        }
+
+        template<typename FirstType, typename... RestTypes>
+        typename std::enable_if<!std::is_same<typename std::decay<FirstType>::type, Request::Parameters>::value>::type
+        Notify(const std::string& methodName, FirstType&& first, RestTypes&&... rest) {
+            Request::Parameters params;
+            AddParameters(params, std::forward<FirstType>(first), std::forward<RestTypes>(rest)...);
+            NotifyInternal(methodName, params);
+        }
+
+    protected:
+        virtual Value CallInternal(const std::string& methodName, const Request::Parameters& params) = 0;
+        virtual void NotifyInternal(const std::string& methodName, const Request::Parameters& params) = 0;
+
+    private:
+        static void AddParameters(Request::Parameters&) {
+            // Empty
+        }
+
+        template<typename FirstType, typename... RestTypes>
+        static void AddParameters(Request::Parameters& params, FirstType&& first, RestTypes&&... rest) {
+            params.emplace_back(std::forward<FirstType>(first));
+            AddParameters(params, std::forward<RestTypes>(rest)...);
+        }
+    };
+
+    // Calls a Dispatcher in the same process. Parameters go to the method as
+    // they are and its result comes back as it is, nothing is ever written
+    // in or read from any format. Values therefore keep types a reader on
+    // the other end of a connection would change, such as INTEGER_64 for
+    // small integers or BINARY over JSON; the README lists where they
+    // differ.
+    class LoopbackTransport : public Transport {
+    public:
+        explicit LoopbackTransport(const Dispatcher& dispatcher) : myDispatcher(dispatcher) {}
+
+    protected:
+        Value CallInternal(const std::string& methodName, const Request::Parameters& params) override {
+            Response response = myDispatcher.Invoke(methodName, params, Value());
+            response.ThrowIfFault();
+            return std::move(response.GetResult());
+        }
+
+        void NotifyInternal(const std::string& methodName, const Request::Parameters& params) override {
+            myDispatcher.Invoke(methodName, params, Value(false));
+        }
+
+    private:
+        const Dispatcher& myDispatcher;
+    };
+
+    // Makes calls through a Client over a connection the caller provides.
+    // The exchange function sends the request and returns the response; for
+    // notifications it only sends, and what it returns is ignored.
+    class ClientTransport : public Transport {
+    public:
+        typedef std::function<std::string(const std::shared_ptr<FormattedData>& data)> Exchange;
+
+        ClientTransport(Client& client, Exchange exchange) : myClient(client), myExchange(std::move(exchange)) {}
+
+    protected:
+        Value CallInternal(const std::string& methodName, const Request::Parameters& params) override {
+            Response response = myClient.ParseResponse(myExchange(myClient.BuildRequestData(methodName, params)));
+            return std::move(response.GetResult());
+        }
+
+        void NotifyInternal(const std::string& methodName, const Request::Parameters& params) override {
+            myExchange(myClient.BuildNotificationData(methodName, params));
+        }
+
+    private:
+        Client& myClient;
+        Exchange myExchange;
+    };
+
+} // namespace jsonrpc
+
+#endif // JSONRPC_LEAN_TRANSPORT_H
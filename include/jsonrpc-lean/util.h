@@ -9,10 +9,32 @@
 
 #include <stdint.h>
 #include <string.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 #include <cassert>
 #include <sstream>
 #include <iomanip>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSONRPC_LEAN_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define JSONRPC_LEAN_NEON
+#include <arm_neon.h>
+#endif
+
+// The base64 kernels need pshufb, i.e. building with -mssse3, -mavx2 or
+// -march=native (/arch:AVX or /arch:AVX2 with MSVC)
+#if defined(__SSSE3__) || defined(__AVX__)
+#define JSONRPC_LEAN_SSSE3
+#include <tmmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define JSONRPC_LEAN_AVX2
+#include <immintrin.h>
+#endif
+
 struct tm;
 
 namespace {
@@ -60,69 +82,174 @@ namespace {
 namespace jsonrpc {
     namespace util {
 
-        inline std::string Base64Encode(const std::string& data); // forward declaration
+#if defined(JSONRPC_LEAN_SSSE3)
+        // Base64 kernels after Wojciech Muła's SIMD base64 work: 12 input
+        // bytes are spread over 16 sextets with a shuffle and two multiplies,
+        // which are then mapped to ASCII by adding an offset picked per range
+        inline __m128i Base64EncodeSextets(__m128i in) {
+            in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+            const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+            const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+            const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+            const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+            return _mm_or_si128(t1, t3);
+        }
 
-        inline std::string Base64Encode(const char* data, size_t size) {
-            const size_t lineLength = 76;
-            static_assert(lineLength % 4 == 0, "invalid line length");
+        inline __m128i Base64EncodeAscii(__m128i sextets) {
+            // 0..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12, then 0..25 -> 13
+            __m128i range = _mm_subs_epu8(sextets, _mm_set1_epi8(51));
+            const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), sextets);
+            range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+            const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+            return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), sextets);
+        }
 
-            if (size == 0) {
-                return{};
+        // Maps 16 characters back to sextets, false if any of them is not in
+        // the alphabet
+        inline bool Base64DecodeSextets(__m128i in, __m128i& sextets) {
+            const __m128i high = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+            const __m128i low = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+
+            // Bit (1 << high nibble) is set in validLow[low nibble] for each
+            // valid character
+            const __m128i validLow = _mm_setr_epi8(
+                static_cast<char>(0xa8), static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf8),
+                static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf8),
+                static_cast<char>(0xf8), static_cast<char>(0xf8), static_cast<char>(0xf0), 0x54, 0x50, 0x50, 0x50, 0x54);
+            const __m128i highBit = _mm_setr_epi8(
+                0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, static_cast<char>(0x80), 0, 0, 0, 0, 0, 0, 0, 0);
+            const __m128i valid = _mm_and_si128(_mm_shuffle_epi8(validLow, low), _mm_shuffle_epi8(highBit, high));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(valid, _mm_setzero_si128())) != 0) {
+                return false;
             }
 
-            const size_t encodedSize = 4 * ((size + 2) / 3);
-            std::string str(encodedSize + 2 * ((encodedSize - 1) / lineLength), '\0');
+            // '+' and '/' share a high nibble, '/' is fixed up separately
+            const __m128i offsets = _mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+            const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+            const __m128i offset = _mm_or_si128(_mm_andnot_si128(slash, _mm_shuffle_epi8(offsets, high)),
+                _mm_and_si128(slash, _mm_set1_epi8(16)));
+            sextets = _mm_add_epi8(in, offset);
+            return true;
+        }
+
+        // 16 sextets to 12 bytes, in the low 12 bytes of the result
+        inline __m128i Base64PackSextets(__m128i sextets) {
+            const __m128i pairs = _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+            const __m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+            return _mm_shuffle_epi8(words, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        }
+#endif
 
+#if defined(JSONRPC_LEAN_AVX2)
+        // The same, on two 12 byte groups per step
+        inline __m256i Base64EncodeAscii(__m256i in) {
+            in = _mm256_shuffle_epi8(in, _mm256_set_epi8(
+                10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+            const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+            const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+            const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+            const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+            const __m256i sextets = _mm256_or_si256(t1, t3);
+
+            __m256i range = _mm256_subs_epu8(sextets, _mm256_set1_epi8(51));
+            const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), sextets);
+            range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+            const __m256i offsets = _mm256_setr_epi8(
+                'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+            return _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), sextets);
+        }
+#endif
+
+        // Length of size bytes in base64, padded and without line breaks
+        inline size_t Base64EncodedSize(size_t size) {
+            return 4 * ((size + 2) / 3);
+        }
+
+        // Upper bound for the number of bytes size characters decode to
+        inline size_t Base64DecodedMaxSize(size_t size) {
+            return 3 * ((size + 3) / 4);
+        }
+
+        // Encodes data as padded base64 without line breaks into out, which
+        // must have room for Base64EncodedSize(size) characters. Returns the
+        // end of the output.
+        inline char* Base64EncodeTo(const char* data, size_t size, char* out) {
             size_t in = 0;
-            size_t out = 0;
-            for (size_t wrap = lineLength; in + 3 <= size; in += 3, wrap -= 4) {
-                if (wrap == 0) {
-                    str[out++] = '\r';
-                    str[out++] = '\n';
-                    wrap = lineLength;
-                }
-                str[out++] = Base64Char0(data[in]);
-                str[out++] = Base64Char1(data[in], data[in + 1]);
-                str[out++] = Base64Char2(data[in + 1], data[in + 2]);
-                str[out++] = Base64Char3(data[in + 2]);
+#if defined(JSONRPC_LEAN_AVX2)
+            // Each lane loads 16 bytes to use 12 of them
+            for (; in + 28 <= size; in += 24, out += 32) {
+                const __m256i bytes = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + in))),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + in + 12)), 1);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), Base64EncodeAscii(bytes));
+            }
+#endif
+#if defined(JSONRPC_LEAN_SSSE3)
+            for (; in + 16 <= size; in += 12, out += 16) {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + in));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), Base64EncodeAscii(Base64EncodeSextets(bytes)));
+            }
+#endif
+            for (; in + 3 <= size; in += 3) {
+                *out++ = Base64Char0(data[in]);
+                *out++ = Base64Char1(data[in], data[in + 1]);
+                *out++ = Base64Char2(data[in + 1], data[in + 2]);
+                *out++ = Base64Char3(data[in + 2]);
             }
 
             if (in < size) {
-                str[out++] = Base64Char0(data[in]);
+                *out++ = Base64Char0(data[in]);
                 if (in + 1 < size) {
-                    str[out++] = Base64Char1(data[in], data[in + 1]);
-                    str[out++] = Base64Char2(data[in + 1], 0);
+                    *out++ = Base64Char1(data[in], data[in + 1]);
+                    *out++ = Base64Char2(data[in + 1], 0);
                 } else {
-                    str[out++] = Base64Char1(data[in], 0);
-                    str[out++] = '=';
+                    *out++ = Base64Char1(data[in], 0);
+                    *out++ = '=';
                 }
-                str[out++] = '=';
+                *out++ = '=';
             }
-
-            assert(str.size() == out);
-            return str;
+            return out;
         }
 
-        inline std::string Base64Decode(const std::string& str); // forward declaration
-
-        inline std::string Base64Decode(const char* str, size_t size) {
-            const size_t maxDecodedSize = 3 * ((size + 3) / 4);
-
-            std::string data(maxDecodedSize, '\0');
+        // Decodes base64 into out, which must have room for
+        // Base64DecodedMaxSize(size) bytes. Like Base64Decode, characters
+        // outside the alphabet (line breaks, padding) are skipped. Returns the
+        // number of bytes written.
+        inline size_t Base64DecodeTo(const char* str, size_t size, char* out) {
+            size_t in = 0;
+            char* const begin = out;
+#if defined(JSONRPC_LEAN_SSSE3)
+            // Whole blocks of alphabet characters only, the first block with
+            // anything else in it is left to the scalar loop
+            for (; in + 16 <= size; in += 16, out += 12) {
+                __m128i sextets;
+                if (!Base64DecodeSextets(_mm_loadu_si128(reinterpret_cast<const __m128i*>(str + in)), sextets)) {
+                    break;
+                }
+                const __m128i bytes = Base64PackSextets(sextets);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out), bytes);
+                const uint32_t tail = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(bytes, 8)));
+                memcpy(out + 8, &tail, sizeof(tail));
+            }
+#endif
 
-            size_t out = 0;
             uint32_t bits = 0;
             size_t bitCount = 0;
 
-            for (size_t in = 0; in < size; ++in) {
+            for (; in < size; ++in) {
                 const int value = BASE_64_LUT[static_cast<uint8_t>(str[in])];
                 if (value != -1) {
                     bits = (bits << 6) | value;
                     bitCount += 6;
                     if (bitCount == 24) {
-                        data[out++] = bits >> 16;
-                        data[out++] = bits >> 8;
-                        data[out++] = bits;
+                        *out++ = static_cast<char>(bits >> 16);
+                        *out++ = static_cast<char>(bits >> 8);
+                        *out++ = static_cast<char>(bits);
 
                         bits = 0;
                         bitCount = 0;
@@ -133,16 +260,283 @@ namespace jsonrpc {
             if (bitCount >= 12) {
                 bits = bits >> (bitCount % 8);
                 if (bitCount == 18) {
-                    data[out++] = bits >> 8;
+                    *out++ = static_cast<char>(bits >> 8);
+                }
+                *out++ = static_cast<char>(bits);
+            }
+
+            return static_cast<size_t>(out - begin);
+        }
+
+        // Whether str is padded base64 without line breaks, as
+        // Base64EncodeTo writes it, 16 characters per step with SSSE3
+        inline bool IsBase64(const char* str, size_t size) {
+            if (size % 4 != 0) {
+                return false;
+            }
+            size_t end = size;
+            if (end > 0 && str[end - 1] == '=') {
+                end -= end > 1 && str[end - 2] == '=' ? 2 : 1;
+            }
+
+            size_t i = 0;
+#if defined(JSONRPC_LEAN_SSSE3)
+            for (; i + 16 <= end; i += 16) {
+                __m128i sextets;
+                if (!Base64DecodeSextets(_mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i)), sextets)) {
+                    return false;
+                }
+            }
+#endif
+            for (; i < end; ++i) {
+                if (BASE_64_LUT[static_cast<uint8_t>(str[i])] == -1) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        inline std::string Base64Encode(const std::string& data); // forward declaration
+
+        // MIME style, with a line break every 76 characters
+        inline std::string Base64Encode(const char* data, size_t size) {
+            const size_t lineLength = 76;
+            static_assert(lineLength % 4 == 0, "invalid line length");
+            const size_t lineBytes = lineLength / 4 * 3;
+
+            if (size == 0) {
+                return{};
+            }
+
+            const size_t encodedSize = Base64EncodedSize(size);
+            std::string str(encodedSize + 2 * ((encodedSize - 1) / lineLength), '\0');
+
+            char* out = &str[0];
+            for (size_t in = 0; in < size; in += lineBytes) {
+                if (in != 0) {
+                    *out++ = '\r';
+                    *out++ = '\n';
                 }
-                data[out++] = bits;
+                out = Base64EncodeTo(data + in, size - in < lineBytes ? size - in : lineBytes, out);
             }
 
-            assert(data.size() >= out);
-            data.resize(out);
+            assert(str.size() == static_cast<size_t>(out - str.data()));
+            return str;
+        }
+
+        inline std::string Base64Decode(const std::string& str); // forward declaration
+
+        inline std::string Base64Decode(const char* str, size_t size) {
+            std::string data(Base64DecodedMaxSize(size), '\0');
+            data.resize(Base64DecodeTo(str, size, &data[0]));
             return data;
         }
 
+        // Index of the lowest set bit, mask must not be 0
+        inline unsigned CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return static_cast<unsigned>(index);
+#else
+            return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+        }
+
+        // Offset of the first character a JSON string has to escape ('"',
+        // '\\' or a control character), size if there is none. Scans 32 bytes
+        // per step with AVX2, SSE2 or NEON.
+        inline size_t FindJsonEscape(const char* data, size_t size) {
+            // Escapes often come close together, a vector step only pays off
+            // once the first few characters turned out clean
+            const size_t head = size < 8 ? size : 8;
+            for (size_t i = 0; i < head; ++i) {
+                const uint8_t c = static_cast<uint8_t>(data[i]);
+                if (c < 0x20 || c == '"' || c == '\\') {
+                    return i;
+                }
+            }
+
+            size_t i = head;
+#if defined(JSONRPC_LEAN_AVX2)
+            const __m256i control = _mm256_set1_epi8(0x1f);
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i backslash = _mm256_set1_epi8('\\');
+            for (; i + 32 <= size; i += 32) {
+                const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+                const __m256i escape = _mm256_or_si256(
+                    _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control), control),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)));
+                const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(escape));
+                if (mask != 0) {
+                    return i + CountTrailingZeros(mask);
+                }
+            }
+#elif defined(JSONRPC_LEAN_SSE2)
+            const __m128i control = _mm_set1_epi8(0x1f);
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            for (; i + 32 <= size; i += 32) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16));
+                const __m128i escapeA = _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(a, control), control),
+                    _mm_or_si128(_mm_cmpeq_epi8(a, quote), _mm_cmpeq_epi8(a, backslash)));
+                const __m128i escapeB = _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(b, control), control),
+                    _mm_or_si128(_mm_cmpeq_epi8(b, quote), _mm_cmpeq_epi8(b, backslash)));
+                const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(escapeA))
+                    | static_cast<uint32_t>(_mm_movemask_epi8(escapeB)) << 16;
+                if (mask != 0) {
+                    return i + CountTrailingZeros(mask);
+                }
+            }
+#elif defined(JSONRPC_LEAN_NEON)
+            const uint8x16_t control = vdupq_n_u8(0x20);
+            const uint8x16_t quote = vdupq_n_u8('"');
+            const uint8x16_t backslash = vdupq_n_u8('\\');
+            for (; i + 32 <= size; i += 32) {
+                const uint8x16_t a = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+                const uint8x16_t b = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i + 16));
+                const uint8x16_t escape = vorrq_u8(
+                    vorrq_u8(vcltq_u8(a, control), vorrq_u8(vceqq_u8(a, quote), vceqq_u8(a, backslash))),
+                    vorrq_u8(vcltq_u8(b, control), vorrq_u8(vceqq_u8(b, quote), vceqq_u8(b, backslash))));
+                if (vmaxvq_u8(escape) != 0) {
+                    // Somewhere in these 32 bytes, the scalar loop finds it
+                    break;
+                }
+            }
+#endif
+            for (; i < size; ++i) {
+                const uint8_t c = static_cast<uint8_t>(data[i]);
+                if (c < 0x20 || c == '"' || c == '\\') {
+                    return i;
+                }
+            }
+            return size;
+        }
+
+        // Whether data is well-formed UTF-8: no overlong forms, surrogates or
+        // code points above U+10FFFF. Runs of ASCII are skipped 16 bytes at a
+        // time where the target has SSE2 or NEON.
+        inline bool IsValidUtf8(const char* data, size_t size) {
+            const uint8_t* const bytes = reinterpret_cast<const uint8_t*>(data);
+            size_t i = 0;
+            while (i < size) {
+#if defined(JSONRPC_LEAN_SSE2)
+                if (i + 16 <= size
+                    && _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i))) == 0) {
+                    i += 16;
+                    continue;
+                }
+#elif defined(JSONRPC_LEAN_NEON)
+                if (i + 16 <= size && vmaxvq_u8(vld1q_u8(bytes + i)) < 0x80) {
+                    i += 16;
+                    continue;
+                }
+#endif
+                const uint8_t c = bytes[i];
+                if (c < 0x80) {
+                    ++i;
+                    continue;
+                }
+
+                // Length of the sequence and the allowed range of its second
+                // byte, which rules out overlong forms and surrogates
+                size_t length;
+                uint8_t low = 0x80;
+                uint8_t high = 0xbf;
+                if (c >= 0xc2 && c <= 0xdf) {
+                    length = 2;
+                } else if (c >= 0xe0 && c <= 0xef) {
+                    length = 3;
+                    if (c == 0xe0) {
+                        low = 0xa0;
+                    } else if (c == 0xed) {
+                        high = 0x9f;
+                    }
+                } else if (c >= 0xf0 && c <= 0xf4) {
+                    length = 4;
+                    if (c == 0xf0) {
+                        low = 0x90;
+                    } else if (c == 0xf4) {
+                        high = 0x8f;
+                    }
+                } else {
+                    return false;
+                }
+
+                if (size - i < length || bytes[i + 1] < low || bytes[i + 1] > high) {
+                    return false;
+                }
+                for (size_t k = 2; k < length; ++k) {
+                    if ((bytes[i + k] & 0xc0) != 0x80) {
+                        return false;
+                    }
+                }
+                i += length;
+            }
+            return true;
+        }
+
+        // Whether data contains a '\0' byte, 32 bytes per step where the
+        // target has SSE2 or NEON
+        inline bool HasNulByte(const char* data, size_t size) {
+            size_t i = 0;
+#if defined(JSONRPC_LEAN_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + 32 <= size; i += 32) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(a, b), zero)) != 0) {
+                    return true;
+                }
+            }
+#elif defined(JSONRPC_LEAN_NEON)
+            for (; i + 32 <= size; i += 32) {
+                const uint8x16_t a = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+                const uint8x16_t b = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i + 16));
+                if (vminvq_u8(vminq_u8(a, b)) == 0) {
+                    return true;
+                }
+            }
+#endif
+            return i < size && memchr(data + i, '\0', size - i) != nullptr;
+        }
+
+        // Network byte order, as the binary formats use for lengths and numbers
+        inline char* StoreBigEndian(char* out, uint16_t value) {
+            out[0] = static_cast<char>(value >> 8);
+            out[1] = static_cast<char>(value);
+            return out + 2;
+        }
+
+        inline char* StoreBigEndian(char* out, uint32_t value) {
+            out[0] = static_cast<char>(value >> 24);
+            out[1] = static_cast<char>(value >> 16);
+            out[2] = static_cast<char>(value >> 8);
+            out[3] = static_cast<char>(value);
+            return out + 4;
+        }
+
+        inline char* StoreBigEndian(char* out, uint64_t value) {
+            StoreBigEndian(out, static_cast<uint32_t>(value >> 32));
+            return StoreBigEndian(out + 4, static_cast<uint32_t>(value));
+        }
+
+        inline uint16_t LoadBigEndian16(const char* in) {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(in);
+            return static_cast<uint16_t>(bytes[0] << 8 | bytes[1]);
+        }
+
+        inline uint32_t LoadBigEndian32(const char* in) {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(in);
+            return static_cast<uint32_t>(bytes[0]) << 24 | static_cast<uint32_t>(bytes[1]) << 16
+                | static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+        }
+
+        inline uint64_t LoadBigEndian64(const char* in) {
+            return static_cast<uint64_t>(LoadBigEndian32(in)) << 32 | LoadBigEndian32(in + 4);
+        }
+
     } // namespace util
 } // namespace jsonrpc
 
@@ -7,9 +7,12 @@
 #ifndef JSONRPC_LEAN_VALUE_H
 #define JSONRPC_LEAN_VALUE_H
 
+#include <algorithm>
 #include <cstdint>
 #include <iosfwd>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -17,6 +20,7 @@
 
 #include "util.h"
 #include "fault.h"
+#include "rawjson.h"
 #include "writer.h"
 
 namespace jsonrpc {
@@ -26,15 +30,22 @@ namespace jsonrpc {
         typedef std::vector<Value> Array;
         typedef std::string String;
         typedef std::map<std::string, Value> Struct;
+        typedef std::vector<int32_t> Integer32Array;
+        typedef std::vector<int64_t> Integer64Array;
+        typedef std::vector<double> DoubleArray;
 
         enum class Type {
             ARRAY,
             BINARY,
             BOOLEAN,
             DOUBLE,
+            DOUBLE_ARRAY,
             INTEGER_32,
+            INTEGER_32_ARRAY,
             INTEGER_64,
+            INTEGER_64_ARRAY,
             NIL,
+            RAW_JSON,
             STRING,
             STRUCT
         };
@@ -71,6 +82,25 @@ namespace jsonrpc {
             as.myStruct = new Struct(std::move(value));
         }
 
+        Value(RawJson value) : myType(Type::RAW_JSON) {
+            as.myRawJson = new RawJson(std::move(value));
+        }
+
+        Value(Integer32Array value) : myType(Type::INTEGER_32_ARRAY) {
+            as.myNumericArray = new NumericArray();
+            as.myNumericArray->Integer32 = std::move(value);
+        }
+
+        Value(Integer64Array value) : myType(Type::INTEGER_64_ARRAY) {
+            as.myNumericArray = new NumericArray();
+            as.myNumericArray->Integer64 = std::move(value);
+        }
+
+        Value(DoubleArray value) : myType(Type::DOUBLE_ARRAY) {
+            as.myNumericArray = new NumericArray();
+            as.myNumericArray->Double = std::move(value);
+        }
+
         ~Value() {
             Reset();
         }
@@ -116,6 +146,21 @@ namespace jsonrpc {
             case Type::STRUCT:
                 as.myStruct = new Struct(other.AsStruct());
                 break;
+            case Type::RAW_JSON:
+                as.myRawJson = new RawJson(other.AsRawJson());
+                break;
+            case Type::DOUBLE_ARRAY:
+                as.myNumericArray = new NumericArray();
+                as.myNumericArray->Double = other.as.myNumericArray->Double;
+                break;
+            case Type::INTEGER_32_ARRAY:
+                as.myNumericArray = new NumericArray();
+                as.myNumericArray->Integer32 = other.as.myNumericArray->Integer32;
+                break;
+            case Type::INTEGER_64_ARRAY:
+                as.myNumericArray = new NumericArray();
+                as.myNumericArray->Integer64 = other.as.myNumericArray->Integer64;
+                break;
             }
         }
 
@@ -137,25 +182,71 @@ namespace jsonrpc {
             return *this;
         }
 
-        bool IsArray() const { return myType == Type::ARRAY; }
+        // True for the numeric array types as well, which AsArray() also
+        // takes; IsNumericArray() tells them apart
+        bool IsArray() const { return myType == Type::ARRAY || IsNumericArray(); }
         bool IsBinary() const { return myType == Type::BINARY; }
         bool IsBoolean() const { return myType == Type::BOOLEAN; }
         bool IsDouble() const { return myType == Type::DOUBLE; }
+        bool IsDoubleArray() const { return myType == Type::DOUBLE_ARRAY; }
         bool IsInteger32() const { return myType == Type::INTEGER_32; }
+        bool IsInteger32Array() const { return myType == Type::INTEGER_32_ARRAY; }
         bool IsInteger64() const { return myType == Type::INTEGER_64; }
+        bool IsInteger64Array() const { return myType == Type::INTEGER_64_ARRAY; }
+        bool IsNumericArray() const { return IsDoubleArray() || IsInteger32Array() || IsInteger64Array(); }
         bool IsNil() const { return myType == Type::NIL; }
+        bool IsRawJson() const { return myType == Type::RAW_JSON; }
         bool IsString() const { return myType == Type::STRING; }
         bool IsStruct() const { return myType == Type::STRUCT; }
 
         const Array& AsArray() const {
-            if (IsArray()) {
+            if (myType == Type::ARRAY) {
                 return *as.myArray;
+            } else if (IsNumericArray()) {
+                // Boxed on first use, for callers that still want an Array
+                auto& numeric = *as.myNumericArray;
+                std::call_once(numeric.BoxedOnce, [this, &numeric]() {
+                    numeric.Boxed.reset(new Array());
+                    if (IsInteger32Array()) {
+                        numeric.Boxed->assign(numeric.Integer32.begin(), numeric.Integer32.end());
+                    } else if (IsInteger64Array()) {
+                        numeric.Boxed->assign(numeric.Integer64.begin(), numeric.Integer64.end());
+                    } else {
+                        numeric.Boxed->assign(numeric.Double.begin(), numeric.Double.end());
+                    }
+                });
+                return *numeric.Boxed;
             }
             throw InvalidParametersFault();
         }
 
         const String& AsBinary() const { return AsString(); }
 
+        // Room DecodeBinaryTo() needs
+        size_t GetBinaryMaxSize() const {
+            if (IsBinary()) {
+                return as.myString->size();
+            } else if (IsString()) {
+                return util::Base64DecodedMaxSize(as.myString->size());
+            }
+            throw InvalidParametersFault();
+        }
+
+        // Copies the bytes of a BINARY value into out, or decodes those of a
+        // STRING holding base64, which is what JSON readers make of BINARY
+        // values unless told to decode them, see BinaryDetection. Returns
+        // the number of bytes written. Throws InvalidParametersFault for
+        // other values and for strings that are not base64.
+        size_t DecodeBinaryTo(char* out) const {
+            if (IsBinary()) {
+                std::copy(as.myString->begin(), as.myString->end(), out);
+                return as.myString->size();
+            } else if (IsString() && util::IsBase64(as.myString->data(), as.myString->size())) {
+                return util::Base64DecodeTo(as.myString->data(), as.myString->size(), out);
+            }
+            throw InvalidParametersFault();
+        }
+
         const bool& AsBoolean() const {
             if (IsBoolean()) {
                 return as.myBoolean;
@@ -187,6 +278,13 @@ namespace jsonrpc {
             throw InvalidParametersFault();
         }
 
+        const RawJson& AsRawJson() const {
+            if (IsRawJson()) {
+                return *as.myRawJson;
+            }
+            throw InvalidParametersFault();
+        }
+
         const String& AsString() const {
             if (IsString() || IsBinary()) {
                 return *as.myString;
@@ -201,15 +299,64 @@ namespace jsonrpc {
             throw InvalidParametersFault();
         }
 
+        const Integer32Array& AsInteger32Array() const {
+            if (IsInteger32Array()) {
+                return as.myNumericArray->Integer32;
+            } else if (IsEmptyArray()) {
+                static const Integer32Array empty;
+                return empty;
+            }
+            throw InvalidParametersFault();
+        }
+
+        const Integer64Array& AsInteger64Array() const {
+            if (IsInteger64Array()) {
+                return as.myNumericArray->Integer64;
+            } else if (IsInteger32Array()) {
+                auto& numeric = *as.myNumericArray;
+                std::call_once(numeric.Integer64Once, [&numeric]() {
+                    numeric.Integer64.assign(numeric.Integer32.begin(), numeric.Integer32.end());
+                });
+                return numeric.Integer64;
+            } else if (IsEmptyArray()) {
+                static const Integer64Array empty;
+                return empty;
+            }
+            throw InvalidParametersFault();
+        }
+
+        const DoubleArray& AsDoubleArray() const {
+            if (IsDoubleArray()) {
+                return as.myNumericArray->Double;
+            } else if (IsInteger32Array() || IsInteger64Array()) {
+                auto& numeric = *as.myNumericArray;
+                std::call_once(numeric.DoubleOnce, [this, &numeric]() {
+                    if (IsInteger32Array()) {
+                        numeric.Double.assign(numeric.Integer32.begin(), numeric.Integer32.end());
+                    } else {
+                        numeric.Double.assign(numeric.Integer64.begin(), numeric.Integer64.end());
+                    }
+                });
+                return numeric.Double;
+            } else if (IsEmptyArray()) {
+                static const DoubleArray empty;
+                return empty;
+            }
+            throw InvalidParametersFault();
+        }
+
         template<typename T>
         inline const T& AsType() const;
 
         Type GetType() const { return myType; }
 
-        void Write(Writer& writer) const {
+        // WriterType is either the Writer interface or a concrete (final)
+        // writer, in which case every call below can be inlined
+        template<typename WriterType>
+        void Write(WriterType& writer) const {
             switch (myType) {
             case Type::ARRAY:
-                writer.StartArray();
+                writer.StartSizedArray(as.myArray->size());
                 for (auto& element : *as.myArray) {
                     element.Write(writer);
                 }
@@ -233,11 +380,14 @@ namespace jsonrpc {
             case Type::NIL:
                 writer.WriteNull();
                 break;
+            case Type::RAW_JSON:
+                writer.WriteRawJson(*as.myRawJson);
+                break;
             case Type::STRING:
                 writer.Write(*as.myString);
                 break;
             case Type::STRUCT:
-                writer.StartStruct();
+                writer.StartSizedStruct(as.myStruct->size());
                 for (auto& element : *as.myStruct) {
                     writer.StartStructElement(element.first);
                     element.second.Write(writer);
@@ -245,6 +395,15 @@ namespace jsonrpc {
                 }
                 writer.EndStruct();
                 break;
+            case Type::DOUBLE_ARRAY:
+                writer.WriteArray(as.myNumericArray->Double.data(), as.myNumericArray->Double.size());
+                break;
+            case Type::INTEGER_32_ARRAY:
+                writer.WriteArray(as.myNumericArray->Integer32.data(), as.myNumericArray->Integer32.size());
+                break;
+            case Type::INTEGER_64_ARRAY:
+                writer.WriteArray(as.myNumericArray->Integer64.data(), as.myNumericArray->Integer64.size());
+                break;
             }
         }
 
@@ -252,11 +411,32 @@ namespace jsonrpc {
         inline const Value& operator[](const Struct::key_type& key) const;
 
     private:
+        // Contiguous storage for the homogeneous numeric array types. Only the
+        // vector matching myType is authoritative, the others are conversion
+        // caches filled by the widening accessors and by AsArray(), each
+        // once, so that threads may read the same Value concurrently.
+        struct NumericArray {
+            Integer32Array Integer32;
+            Integer64Array Integer64;
+            DoubleArray Double;
+            std::unique_ptr<Array> Boxed;
+            std::once_flag Integer64Once;
+            std::once_flag DoubleOnce;
+            std::once_flag BoxedOnce;
+        };
+
+        bool IsEmptyArray() const { return myType == Type::ARRAY && as.myArray->empty(); }
+
         void Reset() {
             switch (myType) {
             case Type::ARRAY:
                 delete as.myArray;
                 break;
+            case Type::DOUBLE_ARRAY:
+            case Type::INTEGER_32_ARRAY:
+            case Type::INTEGER_64_ARRAY:
+                delete as.myNumericArray;
+                break;
             case Type::BINARY:
             case Type::STRING:
                 delete as.myString;
@@ -264,6 +444,9 @@ namespace jsonrpc {
             case Type::STRUCT:
                 delete as.myStruct;
                 break;
+            case Type::RAW_JSON:
+                delete as.myRawJson;
+                break;
 
             case Type::BOOLEAN:
             case Type::DOUBLE:
@@ -282,6 +465,8 @@ namespace jsonrpc {
             bool myBoolean;
             String* myString;
             Struct* myStruct;
+            NumericArray* myNumericArray;
+            RawJson* myRawJson;
             struct {
                 double myDouble;
                 int32_t myInteger32;
@@ -310,6 +495,10 @@ namespace jsonrpc {
         return AsInteger64();
     }
 
+    template<> inline const RawJson& Value::AsType<RawJson>() const {
+        return AsRawJson();
+    }
+
     template<> inline const Value::String& Value::AsType<typename Value::String>() const {
         return AsString();
     }
@@ -318,6 +507,18 @@ namespace jsonrpc {
         return AsStruct();
     }
 
+    template<> inline const Value::Integer32Array& Value::AsType<typename Value::Integer32Array>() const {
+        return AsInteger32Array();
+    }
+
+    template<> inline const Value::Integer64Array& Value::AsType<typename Value::Integer64Array>() const {
+        return AsInteger64Array();
+    }
+
+    template<> inline const Value::DoubleArray& Value::AsType<typename Value::DoubleArray>() const {
+        return AsDoubleArray();
+    }
+
     template<> inline const Value& Value::AsType<Value>() const {
         return *this;
     }
@@ -332,7 +533,10 @@ namespace jsonrpc {
 
     inline std::ostream& operator<<(std::ostream& os, const Value& value) {
         switch (value.GetType()) {
-        case Value::Type::ARRAY: {
+        case Value::Type::ARRAY:
+        case Value::Type::DOUBLE_ARRAY:
+        case Value::Type::INTEGER_32_ARRAY:
+        case Value::Type::INTEGER_64_ARRAY: {
             os << '[';
             auto& a = value.AsArray();
             for (auto it = a.begin(); it != a.end(); ++it) {
@@ -362,6 +566,9 @@ namespace jsonrpc {
         case Value::Type::NIL:
             os << "<nil>";
             break;
+        case Value::Type::RAW_JSON:
+            os << value.AsRawJson().GetJson();
+            break;
         case Value::Type::STRING:
             os << '"' << value.AsString() << '"';
             break;
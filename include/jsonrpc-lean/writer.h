@@ -7,9 +7,12 @@
 #ifndef JSONRPC_LEAN_WRITER_H
 #define JSONRPC_LEAN_WRITER_H
 
+#include <cstdint>
 #include <string>
 #include <memory>
+#include "fault.h"
 #include "formatteddata.h"
+#include "rawjson.h"
 
 struct tm;
 
@@ -56,6 +59,61 @@ namespace jsonrpc {
         virtual void Write(int32_t value) = 0;
         virtual void Write(int64_t value) = 0;
         virtual void Write(const std::string& value) = 0;
+
+        // A batch: the requests written between these go into one message
+        virtual void StartBatch() {
+            throw InternalErrorFault("Batches are not supported by this format");
+        }
+
+        virtual void EndBatch() {
+            throw InternalErrorFault("Batches are not supported by this format");
+        }
+
+        // Requests naming their method by a Dispatcher assigned id
+        virtual void StartRequestById(int32_t, const Value&) {
+            throw InternalErrorFault("Method ids are not supported by this format");
+        }
+
+        // Containers whose element count is known up front. Formats that put
+        // the count ahead of the elements override these, the others ignore it.
+        virtual void StartSizedArray(size_t) {
+            StartArray();
+        }
+
+        virtual void StartSizedStruct(size_t) {
+            StartStruct();
+        }
+
+        // Pre-serialized JSON, only meaningful to JSON based formats
+        virtual void WriteRawJson(const RawJson&) {
+            throw InternalErrorFault("Raw JSON is not supported by this format");
+        }
+
+        // Homogeneous numeric arrays, formats can override these with
+        // something tighter than one Write call per element
+        virtual void WriteArray(const int32_t* values, size_t size) {
+            StartArray();
+            for (size_t i = 0; i < size; ++i) {
+                Write(values[i]);
+            }
+            EndArray();
+        }
+
+        virtual void WriteArray(const int64_t* values, size_t size) {
+            StartArray();
+            for (size_t i = 0; i < size; ++i) {
+                Write(values[i]);
+            }
+            EndArray();
+        }
+
+        virtual void WriteArray(const double* values, size_t size) {
+            StartArray();
+            for (size_t i = 0; i < size; ++i) {
+                Write(values[i]);
+            }
+            EndArray();
+        }
     };
 
 } // namespace jsonrpc